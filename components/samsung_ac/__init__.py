@@ -5,16 +5,17 @@ from esphome.const import (
     CONF_ID,
     DEVICE_CLASS_TEMPERATURE,
     STATE_CLASS_MEASUREMENT,
+    STATE_CLASS_TOTAL_INCREASING,
+    ENTITY_CATEGORY_DIAGNOSTIC,
     DEVICE_CLASS_HUMIDITY,
     CONF_UNIT_OF_MEASUREMENT,
     CONF_DEVICE_CLASS,
-    CONF_FILTERS,
     UNIT_CELSIUS,
     UNIT_PERCENT,
+    UNIT_MILLISECOND,
 )
 from esphome.core import (
     CORE,
-    Lambda
 )
 
 CODEOWNERS = ["matthias882", "lanwin"]
@@ -34,6 +35,8 @@ Samsung_AC_Mode_Select = samsung_ac.class_(
     "Samsung_AC_Mode_Select", select.Select)
 Samsung_AC_Water_Heater_Mode_Select = samsung_ac.class_(
     "Samsung_AC_Water_Heater_Mode_Select", select.Select)
+Samsung_AC_Custom_Select = samsung_ac.class_(
+    "Samsung_AC_Custom_Select", select.Select)
 Samsung_AC_Number = samsung_ac.class_("Samsung_AC_Number", number.Number)
 Samsung_AC_Climate = samsung_ac.class_("Samsung_AC_Climate", climate.Climate)
 
@@ -71,7 +74,18 @@ CONF_DEVICE_CLIMATE = "climate"
 CONF_DEVICE_ROOM_HUMIDITY = "room_humidity"
 CONF_DEVICE_CUSTOM = "custom_sensor"
 CONF_DEVICE_CUSTOM_MESSAGE = "message"
-CONF_DEVICE_CUSTOM_RAW_FILTERS = "raw_filters"
+CONF_DEVICE_DEADBAND = "deadband"
+CONF_DEVICE_CUSTOM_NUMBER = "custom_number"
+CONF_DEVICE_CUSTOM_SWITCH = "custom_switch"
+CONF_DEVICE_CUSTOM_SELECT = "custom_select"
+CONF_DEVICE_CUSTOM_DIVISOR = "divisor"
+CONF_DEVICE_CUSTOM_MIN_VALUE = "min_value"
+CONF_DEVICE_CUSTOM_MAX_VALUE = "max_value"
+CONF_DEVICE_CUSTOM_STEP = "step"
+CONF_DEVICE_CUSTOM_OPTIONS = "options"
+CONF_DEVICE_POLL = "poll"
+CONF_DEVICE_POLL_INTERVAL = "interval"
+CONF_DEVICE_POLL_PRIORITY = "priority"
 CONF_DEVICE_ERROR_CODE = "error_code"
 
 
@@ -121,6 +135,50 @@ CAPABILITIES_SCHEMA = (
 
 CUSTOM_SENSOR_SCHEMA = sensor.sensor_schema().extend({
     cv.Required(CONF_DEVICE_CUSTOM_MESSAGE): cv.hex_int,
+    cv.Optional(CONF_DEVICE_DEADBAND): cv.positive_float,
+})
+
+
+def writable_message(value):
+    value = cv.hex_int(value)
+    # NASA structure messages (type bits 0b11) carry raw bytes instead of a value
+    if (value & 0x600) >> 9 == 3:
+        raise cv.Invalid(f"Message 0x{value:04x} is a structure and cannot be written")
+    return value
+
+
+CUSTOM_NUMBER_SCHEMA = NUMBER_SCHEMA.extend({
+    cv.Required(CONF_DEVICE_CUSTOM_MESSAGE): writable_message,
+    cv.Required(CONF_DEVICE_CUSTOM_MIN_VALUE): cv.float_,
+    cv.Required(CONF_DEVICE_CUSTOM_MAX_VALUE): cv.float_,
+    cv.Optional(CONF_DEVICE_CUSTOM_STEP, default=1): cv.positive_float,
+    cv.Optional(CONF_DEVICE_CUSTOM_DIVISOR, default=1): cv.positive_not_null_float,
+})
+
+CUSTOM_SWITCH_SCHEMA = switch.switch_schema(Samsung_AC_Switch).extend({
+    cv.Required(CONF_DEVICE_CUSTOM_MESSAGE): writable_message,
+})
+
+CUSTOM_SELECT_SCHEMA = select.select_schema(Samsung_AC_Custom_Select).extend({
+    cv.Required(CONF_DEVICE_CUSTOM_MESSAGE): writable_message,
+    cv.Required(CONF_DEVICE_CUSTOM_OPTIONS): cv.Schema({cv.int_: cv.string}),
+})
+
+
+POLL_SCHEMA = cv.Schema({
+    cv.Required(CONF_DEVICE_CUSTOM_MESSAGE): cv.hex_int,
+    cv.Optional(CONF_DEVICE_POLL_INTERVAL, default="60s"): cv.positive_time_period_milliseconds,
+    cv.Optional(CONF_DEVICE_POLL_PRIORITY, default=0): cv.int_range(min=0, max=255),
+})
+
+
+TEMPERATURE_SENSOR_SCHEMA = sensor.sensor_schema(
+    unit_of_measurement=UNIT_CELSIUS,
+    accuracy_decimals=1,
+    device_class=DEVICE_CLASS_TEMPERATURE,
+    state_class=STATE_CLASS_MEASUREMENT,
+).extend({
+    cv.Optional(CONF_DEVICE_DEADBAND): cv.positive_float,
 })
 
 
@@ -132,7 +190,6 @@ def custom_sensor_schema(
     device_class: str = sensor._UNDEF,
     state_class: str = sensor._UNDEF,
     entity_category: str = sensor._UNDEF,
-    raw_filters=[]
 ):
     return sensor.sensor_schema(
         unit_of_measurement=unit_of_measurement,
@@ -143,7 +200,7 @@ def custom_sensor_schema(
         entity_category=entity_category,
     ).extend({
         cv.Optional(CONF_DEVICE_CUSTOM_MESSAGE, default=message): cv.hex_int,
-        cv.Optional(CONF_DEVICE_CUSTOM_RAW_FILTERS, default=raw_filters): sensor.validate_filters
+        cv.Optional(CONF_DEVICE_DEADBAND): cv.positive_float,
     })
 
 
@@ -154,10 +211,6 @@ def temperature_sensor_schema(message: int):
         accuracy_decimals=1,
         device_class=DEVICE_CLASS_TEMPERATURE,
         state_class=STATE_CLASS_MEASUREMENT,
-        raw_filters=[
-            {"lambda": Lambda("return (int16_t)x;")},
-            {"multiply": 0.1}
-        ],
     )
 
 
@@ -184,31 +237,11 @@ DEVICE_SCHEMA = (
             cv.GenerateID(CONF_DEVICE_ID): cv.declare_id(Samsung_AC_Device),
             cv.Optional(CONF_CAPABILITIES): CAPABILITIES_SCHEMA,
             cv.Required(CONF_DEVICE_ADDRESS): cv.string,
-            cv.Optional(CONF_DEVICE_ROOM_TEMPERATURE): sensor.sensor_schema(
-                unit_of_measurement=UNIT_CELSIUS,
-                accuracy_decimals=1,
-                device_class=DEVICE_CLASS_TEMPERATURE,
-                state_class=STATE_CLASS_MEASUREMENT,
-            ),
+            cv.Optional(CONF_DEVICE_ROOM_TEMPERATURE): TEMPERATURE_SENSOR_SCHEMA,
             cv.Optional(CONF_DEVICE_ROOM_TEMPERATURE_OFFSET): cv.float_,
-            cv.Optional(CONF_DEVICE_OUTDOOR_TEMPERATURE): sensor.sensor_schema(
-                unit_of_measurement=UNIT_CELSIUS,
-                accuracy_decimals=1,
-                device_class=DEVICE_CLASS_TEMPERATURE,
-                state_class=STATE_CLASS_MEASUREMENT,
-            ),
-             cv.Optional(CONF_DEVICE_INDOOR_EVA_IN_TEMPERATURE): sensor.sensor_schema(
-                unit_of_measurement=UNIT_CELSIUS,
-                accuracy_decimals=1,
-                device_class=DEVICE_CLASS_TEMPERATURE,
-                state_class=STATE_CLASS_MEASUREMENT,
-            ),
-             cv.Optional(CONF_DEVICE_INDOOR_EVA_OUT_TEMPERATURE): sensor.sensor_schema(
-                unit_of_measurement=UNIT_CELSIUS,
-                accuracy_decimals=1,
-                device_class=DEVICE_CLASS_TEMPERATURE,
-                state_class=STATE_CLASS_MEASUREMENT,
-            ),
+            cv.Optional(CONF_DEVICE_OUTDOOR_TEMPERATURE): TEMPERATURE_SENSOR_SCHEMA,
+            cv.Optional(CONF_DEVICE_INDOOR_EVA_IN_TEMPERATURE): TEMPERATURE_SENSOR_SCHEMA,
+            cv.Optional(CONF_DEVICE_INDOOR_EVA_OUT_TEMPERATURE): TEMPERATURE_SENSOR_SCHEMA,
             cv.Optional(CONF_DEVICE_ERROR_CODE): error_code_sensor_schema(0x8235),
             cv.Optional(CONF_DEVICE_TARGET_TEMPERATURE): NUMBER_SCHEMA,
             cv.Optional(CONF_DEVICE_WATER_OUTLET_TARGET): NUMBER_SCHEMA,
@@ -220,8 +253,13 @@ DEVICE_SCHEMA = (
             cv.Optional(CONF_DEVICE_WATER_HEATER_MODE): SELECT_WATER_HEATER_MODE_SCHEMA,
             cv.Optional(CONF_DEVICE_CLIMATE): CLIMATE_SCHEMA,
             cv.Optional(CONF_DEVICE_CUSTOM, default=[]): cv.ensure_list(CUSTOM_SENSOR_SCHEMA),
+            cv.Optional(CONF_DEVICE_CUSTOM_NUMBER, default=[]): cv.ensure_list(CUSTOM_NUMBER_SCHEMA),
+            cv.Optional(CONF_DEVICE_CUSTOM_SWITCH, default=[]): cv.ensure_list(CUSTOM_SWITCH_SCHEMA),
+            cv.Optional(CONF_DEVICE_CUSTOM_SELECT, default=[]): cv.ensure_list(CUSTOM_SELECT_SCHEMA),
+            cv.Optional(CONF_DEVICE_POLL, default=[]): cv.ensure_list(POLL_SCHEMA),
 
-            # keep CUSTOM_SENSOR_KEYS in sync with these
+            # keep CUSTOM_SENSOR_KEYS in sync with these, the values are scaled as described
+            # by the message registry (protocol_nasa.cpp)
             cv.Optional(CONF_DEVICE_WATER_TEMPERATURE): temperature_sensor_schema(0x4237),
             cv.Optional(CONF_DEVICE_ROOM_HUMIDITY): humidity_sensor_schema(0x4038),
         }
@@ -247,6 +285,37 @@ CONF_NON_NASA_KEEPALIVE = "non_nasa_keepalive"
 
 CONF_DEBUG_LOG_UNDEFINED_MESSAGES = "debug_log_undefined_messages"
 
+CONF_RX_TIME_BUDGET = "rx_time_budget"
+
+CONF_PUBLISH_HEARTBEAT = "publish_heartbeat"
+
+CONF_REQUEST_WINDOW = "request_window"
+
+CONF_TX_IDLE_GAP = "tx_idle_gap"
+
+CONF_RECEIVED_PACKETS = "received_packets"
+CONF_DUPLICATE_PACKETS = "duplicate_packets"
+CONF_MISSING_PACKETS = "missing_packets"
+
+PACKET_COUNTER_SCHEMA = sensor.sensor_schema(
+    accuracy_decimals=0,
+    state_class=STATE_CLASS_TOTAL_INCREASING,
+    entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    icon="mdi:counter",
+)
+
+CONF_NON_NASA_POLL_INTERVAL = "non_nasa_poll_interval"
+CONF_NON_NASA_ACK_LATENCY = "non_nasa_ack_latency"
+CONF_NON_NASA_WAKE_LATENCY = "non_nasa_wake_latency"
+
+LATENCY_SCHEMA = sensor.sensor_schema(
+    unit_of_measurement=UNIT_MILLISECOND,
+    accuracy_decimals=0,
+    state_class=STATE_CLASS_MEASUREMENT,
+    entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    icon="mdi:timer-outline",
+)
+
 
 CONFIG_SCHEMA = (
     cv.Schema(
@@ -261,6 +330,16 @@ CONFIG_SCHEMA = (
             cv.Optional(CONF_DEBUG_LOG_MESSAGES_RAW, default=False): cv.boolean,
             cv.Optional(CONF_NON_NASA_KEEPALIVE, default=False): cv.boolean,
             cv.Optional(CONF_DEBUG_LOG_UNDEFINED_MESSAGES, default=False): cv.boolean,
+            cv.Optional(CONF_RX_TIME_BUDGET, default="10ms"): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_PUBLISH_HEARTBEAT, default="5min"): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_REQUEST_WINDOW, default="150ms"): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_TX_IDLE_GAP, default="10ms"): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_RECEIVED_PACKETS): PACKET_COUNTER_SCHEMA,
+            cv.Optional(CONF_DUPLICATE_PACKETS): PACKET_COUNTER_SCHEMA,
+            cv.Optional(CONF_MISSING_PACKETS): PACKET_COUNTER_SCHEMA,
+            cv.Optional(CONF_NON_NASA_POLL_INTERVAL): LATENCY_SCHEMA,
+            cv.Optional(CONF_NON_NASA_ACK_LATENCY): LATENCY_SCHEMA,
+            cv.Optional(CONF_NON_NASA_WAKE_LATENCY): LATENCY_SCHEMA,
             cv.Optional(CONF_CAPABILITIES): CAPABILITIES_SCHEMA,
             cv.Required(CONF_DEVICES): cv.ensure_list(DEVICE_SCHEMA),
         }
@@ -341,6 +420,8 @@ async def to_code(config):
                 conf = device[key]
                 sens = await action(conf)
                 cg.add(method(sens))
+                if CONF_DEVICE_DEADBAND in conf:
+                    cg.add(var_dev.set_deadband(sens, conf[CONF_DEVICE_DEADBAND]))
 
         if CONF_DEVICE_ROOM_TEMPERATURE_OFFSET in device:
             cg.add(var_dev.set_room_temperature_offset(
@@ -399,18 +480,43 @@ async def to_code(config):
                 sens = await sensor.new_sensor(cust_sens)
                 cg.add(var_dev.add_custom_sensor(
                     cust_sens[CONF_DEVICE_CUSTOM_MESSAGE], sens))
+                if CONF_DEVICE_DEADBAND in cust_sens:
+                    cg.add(var_dev.set_deadband(sens, cust_sens[CONF_DEVICE_DEADBAND]))
+
+        for conf in device[CONF_DEVICE_CUSTOM_NUMBER]:
+            num = await number.new_number(conf,
+                                          min_value=conf[CONF_DEVICE_CUSTOM_MIN_VALUE],
+                                          max_value=conf[CONF_DEVICE_CUSTOM_MAX_VALUE],
+                                          step=conf[CONF_DEVICE_CUSTOM_STEP])
+            cg.add(var_dev.add_custom_number(
+                conf[CONF_DEVICE_CUSTOM_MESSAGE], num, conf[CONF_DEVICE_CUSTOM_DIVISOR]))
+
+        for conf in device[CONF_DEVICE_CUSTOM_SWITCH]:
+            sw = await switch.new_switch(conf)
+            cg.add(var_dev.add_custom_switch(conf[CONF_DEVICE_CUSTOM_MESSAGE], sw))
+
+        for conf in device[CONF_DEVICE_CUSTOM_SELECT]:
+            options = conf[CONF_DEVICE_CUSTOM_OPTIONS]
+            sel = await select.new_select(conf, options=list(options.values()))
+            for value, name in options.items():
+                cg.add(sel.add_option(value, name))
+            cg.add(var_dev.add_custom_select(conf[CONF_DEVICE_CUSTOM_MESSAGE], sel))
+
+        for conf in device[CONF_DEVICE_POLL]:
+            cg.add(var_dev.add_poll(conf[CONF_DEVICE_CUSTOM_MESSAGE],
+                   conf[CONF_DEVICE_POLL_INTERVAL], conf[CONF_DEVICE_POLL_PRIORITY]))
 
         for key in CUSTOM_SENSOR_KEYS:
             if key in device:
                 conf = device[key]
-                # combine raw filters with any user-defined filters
-                conf_copy = conf.copy()
-                conf_copy[CONF_FILTERS] = (conf[CONF_DEVICE_CUSTOM_RAW_FILTERS] if CONF_DEVICE_CUSTOM_RAW_FILTERS in conf else [
-                ]) + (conf[CONF_FILTERS] if CONF_FILTERS in conf else [])
-                sens = await sensor.new_sensor(conf_copy)
-                cg.add(var_dev.add_custom_sensor(
+                sens = await sensor.new_sensor(conf)
+                cg.add(var_dev.add_message_sensor(
                     conf[CONF_DEVICE_CUSTOM_MESSAGE], sens))
+                if CONF_DEVICE_DEADBAND in conf:
+                    cg.add(var_dev.set_deadband(sens, conf[CONF_DEVICE_DEADBAND]))
 
+        cg.add(var_dev.set_publish_heartbeat(config[CONF_PUBLISH_HEARTBEAT]))
+        cg.add(var_dev.set_request_window(config[CONF_REQUEST_WINDOW]))
         cg.add(var.register_device(var_dev))
 
     cg.add(var.set_debug_mqtt(config[CONF_DEBUG_MQTT_HOST], config[CONF_DEBUG_MQTT_PORT],
@@ -429,6 +535,22 @@ async def to_code(config):
     if (CONF_DEBUG_LOG_UNDEFINED_MESSAGES in config):
         cg.add(var.set_debug_log_undefined_messages(config[CONF_DEBUG_LOG_UNDEFINED_MESSAGES]))
         
+    cg.add(var.set_rx_time_budget(config[CONF_RX_TIME_BUDGET]))
+    cg.add(var.set_tx_idle_gap(config[CONF_TX_IDLE_GAP]))
+
+    diagnostic_sensors = {
+        CONF_RECEIVED_PACKETS: var.set_received_packets_sensor,
+        CONF_DUPLICATE_PACKETS: var.set_duplicate_packets_sensor,
+        CONF_MISSING_PACKETS: var.set_missing_packets_sensor,
+        CONF_NON_NASA_POLL_INTERVAL: var.set_non_nasa_poll_interval_sensor,
+        CONF_NON_NASA_ACK_LATENCY: var.set_non_nasa_ack_latency_sensor,
+        CONF_NON_NASA_WAKE_LATENCY: var.set_non_nasa_wake_latency_sensor,
+    }
+    for key, method in diagnostic_sensors.items():
+        if key in config:
+            sens = await sensor.new_sensor(config[key])
+            cg.add(method(sens))
+
     # Mapping of config keys to their corresponding methods
     config_actions = {
         CONF_DEBUG_LOG_MESSAGES: var.set_debug_log_messages,
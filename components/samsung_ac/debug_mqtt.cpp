@@ -7,6 +7,8 @@ AsyncMqttClient *mqtt_client{nullptr};
 #elif defined(USE_ESP32)
 #include <mqtt_client.h>
 esp_mqtt_client_handle_t mqtt_client{nullptr};
+#else
+void *mqtt_client{nullptr}; // host builds (tests) have no mqtt client
 #endif
 
 namespace esphome
@@ -22,6 +24,8 @@ namespace esphome
             return mqtt_client->connected();
 #elif defined(USE_ESP32)
             return true;
+#else
+            return false;
 #endif
         }
 
@@ -68,6 +72,8 @@ namespace esphome
             return mqtt_client->publish(topic.c_str(), 0, false, payload.c_str()) != 0;
 #elif defined(USE_ESP32)
             return esp_mqtt_client_publish(mqtt_client, topic.c_str(), payload.c_str(), payload.length(), 0, false) != -1;
+#else
+            return false;
 #endif
         }
     } // namespace samsung_ac
@@ -5,6 +5,7 @@
 #include "esphome/core/helpers.h"
 #include <map>
 #include <string>
+#include "protocol.h"
 
 namespace esphome {
 
@@ -14,14 +15,14 @@ class DeviceStateTracker {
   DeviceStateTracker(unsigned long timeout_period)
       : TIMEOUT_PERIOD(timeout_period) {}
 
-  void update(const std::string &address, const T &current_value) {
+  void update(samsung_ac::DeviceAddress address, const T &current_value) {
     unsigned long now = millis();
 
     if (pending_changes_.find(address) != pending_changes_.end()) {
       if (current_value == pending_changes_[address]) {
         pending_changes_.erase(address);
       } else {
-        ESP_LOGI("device_state_tracker", "Stale value received for device: %s, ignoring.", address.c_str());
+        ESP_LOGI("device_state_tracker", "Stale value received for device: %s, ignoring.", address.to_string().c_str());
         return;
       }
     }
@@ -31,13 +32,13 @@ class DeviceStateTracker {
       last_values_[address] = current_value;
       last_update_time_[address] = now;
 
-      ESP_LOGI("device_state_tracker", "Value changed for device: %s", address.c_str());
+      ESP_LOGI("device_state_tracker", "Value changed for device: %s", address.to_string().c_str());
     } else {
-      ESP_LOGD("device_state_tracker", "No change in value for device: %s", address.c_str());
+      ESP_LOGD("device_state_tracker", "No change in value for device: %s", address.to_string().c_str());
 
       if (now - last_update_time_[address] > TIMEOUT_PERIOD) {
         if (pending_changes_.find(address) != pending_changes_.end()) {
-          ESP_LOGW("device_state_tracker", "Timeout for device: %s, forcing update.", address.c_str());
+          ESP_LOGW("device_state_tracker", "Timeout for device: %s, forcing update.", address.to_string().c_str());
           pending_changes_.erase(address);
         }
       }
@@ -45,9 +46,9 @@ class DeviceStateTracker {
   }
 
  private:
-  std::map<std::string, T> last_values_;
-  std::map<std::string, unsigned long> last_update_time_;
-  std::map<std::string, T> pending_changes_;
+  std::map<samsung_ac::DeviceAddress, T> last_values_;
+  std::map<samsung_ac::DeviceAddress, unsigned long> last_update_time_;
+  std::map<samsung_ac::DeviceAddress, T> pending_changes_;
   const unsigned long TIMEOUT_PERIOD;
 };
 
@@ -1,3 +1,5 @@
+#include <cstdio>
+#include <cstdlib>
 #include "esphome/core/log.h"
 #include "protocol.h"
 #include "util.h"
@@ -13,22 +15,97 @@ namespace esphome
         bool debug_log_undefined_messages = false;
         bool debug_log_messages = false;
 
+        MessageSubscriptions custom_message_subscriptions;
+
         ProtocolProcessing protocol_processing = ProtocolProcessing::Auto;
 
-        // This functions is designed to run after a new value was added
-        // to the data vector. One by one.
-        DataResult process_data(std::vector<uint8_t> &data, MessageTarget *target)
+        void FrameParser::reset()
+        {
+            position_ = 0;
+            nasa_size_ = 0;
+            checksum_ = 0;
+            non_nasa_checksum_ = 0;
+            crc_ = 0;
+            nasa_crc_ = 0;
+        }
+
+        FrameResult FrameParser::feed(uint8_t c)
         {
-            if (data.size() > 1500)
+            const uint16_t index = position_++;
+            switch (index)
             {
-                ESP_LOGV(TAG, "current packat exceeds the size limits: %s", bytes_to_hex(data).c_str());
-                return DataResult::Clear;
+            case 0:
+                if (c != 0x32)
+                {
+                    reset();
+                    return FrameResult::Invalid;
+                }
+                return FrameResult::Incomplete;
+            case 1:
+                nasa_size_ = (uint16_t)c << 8;
+                break;
+            case 2:
+                nasa_size_ = (nasa_size_ | c) + 2; // size field does not include start byte and itself
+                break;
+            case 12:
+                non_nasa_checksum_ = c;
+                break;
             }
 
-            // Check if its a decodeable NonNASA packat
+            // NonNASA checksum is a xor over the bytes 1 to 11
+            if (index <= 11)
+                checksum_ ^= c;
+
+            // NASA crc covers everything between the size field and the crc itself
+            if (index >= 3 && index + 3 < nasa_size_)
+                crc_ = crc16_update(crc_, c);
+            else if (index + 3 == nasa_size_)
+                nasa_crc_ = (uint16_t)c << 8;
+            else if (index + 2 == nasa_size_)
+                nasa_crc_ |= c;
+
+            if (index < 2)
+                return FrameResult::Incomplete;
+
+            const bool allow_non_nasa = protocol_processing != ProtocolProcessing::NASA;
+            const bool allow_nasa = protocol_processing != ProtocolProcessing::NonNASA &&
+                                    nasa_size_ >= 16 && nasa_size_ <= 1500;
+
+            if (index == 13 && allow_non_nasa)
+            {
+                // In auto mode a 14 byte frame could also be the beginning of a NASA packet,
+                // so only accept it when it is valid. Otherwise let the decoder report the error.
+                if (!allow_nasa || (c == 0x34 && checksum_ == non_nasa_checksum_))
+                {
+                    reset();
+                    return FrameResult::NonNasa;
+                }
+            }
+
+            if (!allow_nasa)
+            {
+                if (allow_non_nasa && index < 13)
+                    return FrameResult::Incomplete;
+
+                reset();
+                return FrameResult::Invalid;
+            }
+
+            if (index + 1 == nasa_size_)
+            {
+                const bool crc_valid = crc_ == nasa_crc_;
+                reset();
+                return crc_valid ? FrameResult::Nasa : FrameResult::NasaCrcError;
+            }
+
+            return FrameResult::Incomplete;
+        }
+
+        DecodeResult process_frame(FrameResult frame, ByteSpan data, MessageTarget *target)
+        {
             DecodeResult result = DecodeResult::Ok;
 
-            if (protocol_processing == ProtocolProcessing::Auto || protocol_processing == ProtocolProcessing::NonNASA)
+            if (frame == FrameResult::NonNasa)
             {
                 result = try_decode_non_nasa_packet(data);
                 if (result == DecodeResult::Ok)
@@ -45,13 +122,13 @@ namespace esphome
                     }
 
                     process_non_nasa_packet(target);
-                    return DataResult::Clear;
+                    return result;
                 }
             }
-
-            if (protocol_processing == ProtocolProcessing::Auto || protocol_processing == ProtocolProcessing::NASA)
+            else if (frame == FrameResult::Nasa || frame == FrameResult::NasaCrcError)
             {
-                result = try_decode_nasa_packet(data);
+                // the crc was checked while parsing, only a mismatch is verified (and logged) again
+                result = try_decode_nasa_packet(data, frame == FrameResult::NasaCrcError);
                 if (result == DecodeResult::Ok)
                 {
                     if (debug_log_raw_bytes)
@@ -66,15 +143,10 @@ namespace esphome
                     }
 
                     process_nasa_packet(target);
-                    return DataResult::Clear;
+                    return result;
                 }
             }
 
-            if (result == DecodeResult::SizeDidNotMatch || result == DecodeResult::UnexpectedSize)
-            {
-                return DataResult::Fill;
-            }
-
             if (debug_log_raw_bytes)
             {
                 ESP_LOGV(TAG, "RAW: %s", bytes_to_hex(data).c_str());
@@ -92,31 +164,96 @@ namespace esphome
             {
                 // is logged within decoder
             }
-            return DataResult::Clear;
+            return result;
         }
 
-        bool is_nasa_address(const std::string &address)
+        DeviceAddress DeviceAddress::parse(const std::string &str)
         {
-            return address.size() != 2;
+            const char *c = str.c_str();
+            char *end;
+            const uint8_t first = strtol(c, &end, 16);
+            if (*end != '.')
+                return DeviceAddress::non_nasa(first);
+
+            const uint8_t channel = strtol(end + 1, &end, 16);
+            const uint8_t address = *end == '.' ? strtol(end + 1, &end, 16) : 0;
+            return DeviceAddress::nasa(first, channel, address);
         }
 
-        AddressType get_address_type(const std::string &address)
+        std::string DeviceAddress::to_string() const
         {
-            if (address == "c8" || address.rfind("10.", 0) == 0)
-                return AddressType::Outdoor;
+            char str[9];
+            if (is_nasa())
+                snprintf(str, sizeof(str), "%02x.%02x.%02x", klass(), channel(), address());
+            else
+                snprintf(str, sizeof(str), "%02x", address());
+            return std::string(str);
+        }
 
-            if (address == "00" || address == "01" || address == "02" || address == "03" || address.rfind("20.", 0) == 0)
-                return AddressType::Indoor;
+        void DeviceState::clear()
+        {
+            std::vector<CustomSensorValue> values = std::move(custom_sensors);
+            values.clear();
+            *this = DeviceState();
+            custom_sensors = std::move(values);
+        }
+
+        template <typename T>
+        static void merge_value(optional<T> &value, const optional<T> &other)
+        {
+            if (other)
+                value = other;
+        }
 
+        void ProtocolRequest::merge(const ProtocolRequest &other)
+        {
+            merge_value(power, other.power);
+            merge_value(automatic_cleaning, other.automatic_cleaning);
+            merge_value(water_heater_power, other.water_heater_power);
+            merge_value(mode, other.mode);
+            merge_value(waterheatermode, other.waterheatermode);
+            merge_value(target_temp, other.target_temp);
+            merge_value(water_outlet_target, other.water_outlet_target);
+            merge_value(target_water_temp, other.target_water_temp);
+            merge_value(fan_mode, other.fan_mode);
+            merge_value(swing_mode, other.swing_mode);
+            merge_value(alt_mode, other.alt_mode);
+
+            for (const auto &message : other.custom_messages)
+            {
+                auto it = std::find_if(custom_messages.begin(), custom_messages.end(), [&message](const CustomMessageValue &value)
+                                       { return value.message_number == message.message_number; });
+                if (it != custom_messages.end())
+                    it->value = message.value;
+                else
+                    custom_messages.push_back(message);
+            }
+        }
+
+        AddressType get_address_type(DeviceAddress address)
+        {
+            if (address.is_nasa())
+            {
+                if (address.klass() == 0x10)
+                    return AddressType::Outdoor;
+                if (address.klass() == 0x20)
+                    return AddressType::Indoor;
+                return AddressType::Other;
+            }
+
+            if (address.address() == 0xc8)
+                return AddressType::Outdoor;
+            if (address.address() <= 0x03)
+                return AddressType::Indoor;
             return AddressType::Other;
         }
 
         Protocol *nasaProtocol = new NasaProtocol();
         Protocol *nonNasaProtocol = new NonNasaProtocol();
 
-        Protocol *get_protocol(const std::string &address)
+        Protocol *get_protocol(DeviceAddress address)
         {
-            if (!is_nasa_address(address))
+            if (!address.is_nasa())
                 return nonNasaProtocol;
 
             return nasaProtocol;
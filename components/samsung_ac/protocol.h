@@ -1,8 +1,11 @@
 #pragma once
 
 #include <set>
+#include <vector>
+#include <algorithm>
 #include "esphome/core/optional.h"
 #include "util.h"
+#include "timer_wheel.h"
 
 namespace esphome
 {
@@ -70,30 +73,145 @@ namespace esphome
             All = 3
         };
 
+        // Packed device address. NASA addresses keep class, channel and address in the lower 24 bits
+        // and have bit 24 set, NonNASA addresses are the plain 8 bit id. Strings are only built for
+        // logging and parsed from the yaml configuration.
+        struct DeviceAddress
+        {
+            static constexpr uint32_t NASA_FLAG = 1UL << 24;
+
+            uint32_t value = 0;
+
+            constexpr DeviceAddress() = default;
+            constexpr explicit DeviceAddress(uint32_t value) : value(value) {}
+
+            static constexpr DeviceAddress nasa(uint8_t klass, uint8_t channel, uint8_t address)
+            {
+                return DeviceAddress(NASA_FLAG | (uint32_t)klass << 16 | (uint32_t)channel << 8 | address);
+            }
+            static constexpr DeviceAddress non_nasa(uint8_t address)
+            {
+                return DeviceAddress(address);
+            }
+
+            // "20.00.00" is a NASA address, "00" a NonNASA one
+            static DeviceAddress parse(const std::string &str);
+
+            bool is_nasa() const { return (value & NASA_FLAG) != 0; }
+            uint8_t klass() const { return (value >> 16) & 0xff; }
+            uint8_t channel() const { return (value >> 8) & 0xff; }
+            uint8_t address() const { return value & 0xff; }
+
+            std::string to_string() const;
+
+            bool operator==(const DeviceAddress &other) const { return value == other.value; }
+            bool operator!=(const DeviceAddress &other) const { return value != other.value; }
+            bool operator<(const DeviceAddress &other) const { return value < other.value; }
+        };
+
+        struct CustomSensorValue
+        {
+            uint16_t message_number;
+            float value;        // raw message value
+            float scaled_value; // scaled as described by the NASA message registry, the raw value for unknown messages
+        };
+
+        struct CustomMessageValue
+        {
+            uint16_t message_number;
+            long value;
+        };
+
+        // Message numbers which are bound to custom entities, per device. The decoder only passes
+        // these on for the device which sent them, all other messages are skipped by a single bit
+        // test of the number in the common case.
+        class MessageSubscriptions
+        {
+        public:
+            void add(DeviceAddress address, uint16_t number)
+            {
+                const uint16_t bit = hash(number);
+                bits_[bit / 32] |= 1u << (bit % 32);
+
+                const uint64_t subscription = key(address, number);
+                auto it = std::lower_bound(keys_.begin(), keys_.end(), subscription);
+                if (it == keys_.end() || *it != subscription)
+                    keys_.insert(it, subscription);
+            }
+
+            bool contains(DeviceAddress address, uint16_t number) const
+            {
+                const uint16_t bit = hash(number);
+                if ((bits_[bit / 32] & (1u << (bit % 32))) == 0)
+                    return false;
+                return std::binary_search(keys_.begin(), keys_.end(), key(address, number));
+            }
+
+            size_t size() const { return keys_.size(); }
+
+            void clear()
+            {
+                keys_.clear();
+                std::fill(std::begin(bits_), std::end(bits_), 0);
+            }
+
+        protected:
+            static constexpr uint16_t BITS = 512;
+
+            // the low bits alone collide a lot, as the type is encoded in bits 9 and 10
+            static uint16_t hash(uint16_t number) { return (number ^ (number >> 7)) % BITS; }
+            static uint64_t key(DeviceAddress address, uint16_t number) { return (uint64_t)address.value << 16 | number; }
+
+            uint32_t bits_[BITS / 32] = {};
+            std::vector<uint64_t> keys_; // sorted, device address in the upper bits
+        };
+
+        extern MessageSubscriptions custom_message_subscriptions;
+
+        // Values of one device decoded from a single packet. Only the fields which were part of the
+        // packet are set, so the target can apply them at once and publish every entity only once.
+        struct DeviceState
+        {
+            optional<bool> power;
+            optional<bool> automatic_cleaning;
+            optional<bool> water_heater_power;
+            optional<float> room_temperature;
+            optional<float> target_temperature;
+            optional<float> water_outlet_target;
+            optional<float> outdoor_temperature;
+            optional<float> indoor_eva_in_temperature;
+            optional<float> indoor_eva_out_temperature;
+            optional<float> target_water_temperature;
+            optional<Mode> mode;
+            optional<WaterHeaterMode> water_heater_mode;
+            optional<FanMode> fanmode;
+            optional<AltMode> altmode;
+            optional<bool> swing_vertical;
+            optional<bool> swing_horizontal;
+            optional<int> error_code;
+            std::vector<CustomSensorValue> custom_sensors;
+
+            // Resets all values but keeps the memory of custom_sensors.
+            void clear();
+        };
+
+        // Order in which queued frames are sent, user control goes first.
+        enum class TxPriority : uint8_t
+        {
+            Control = 0,
+            Poll = 1,
+            Keepalive = 2,
+        };
+
         class MessageTarget
         {
         public:
             virtual uint32_t get_miliseconds() = 0;
-            virtual void publish_data(std::vector<uint8_t> &data) = 0;
-            virtual void register_address(const std::string address) = 0;
-            virtual void set_power(const std::string address, bool value) = 0;
-            virtual void set_automatic_cleaning(const std::string address, bool value) = 0;
-            virtual void set_water_heater_power(const std::string address, bool value) = 0;
-            virtual void set_room_temperature(const std::string address, float value) = 0;
-            virtual void set_target_temperature(const std::string address, float value) = 0;
-            virtual void set_water_outlet_target(const std::string address, float value) = 0;
-            virtual void set_outdoor_temperature(const std::string address, float value) = 0;
-            virtual void set_indoor_eva_in_temperature(const std::string address, float value) = 0;
-            virtual void set_indoor_eva_out_temperature(const std::string address, float value) = 0;
-            virtual void set_target_water_temperature(const std::string address, float value) = 0;
-            virtual void set_mode(const std::string address, Mode mode) = 0;
-            virtual void set_water_heater_mode(const std::string address, WaterHeaterMode waterheatermode) = 0;
-            virtual void set_fanmode(const std::string address, FanMode fanmode) = 0;
-            virtual void set_altmode(const std::string address, AltMode altmode) = 0;
-            virtual void set_swing_vertical(const std::string address, bool vertical) = 0;
-            virtual void set_swing_horizontal(const std::string address, bool horizontal) = 0;
-            virtual void set_custom_sensor(const std::string address, uint16_t message_number, float value) = 0;
-            virtual void set_error_code(const std::string address, int error_code) = 0;
+            virtual void publish_data(std::vector<uint8_t> &data, TxPriority priority) = 0;
+            virtual void register_address(DeviceAddress address) = 0;
+            virtual void set_state(DeviceAddress address, const DeviceState &state) = 0;
+            // Timeouts of the protocols, advanced by the target.
+            virtual ProtocolTimers &get_timers() = 0;
         };
 
         struct ProtocolRequest
@@ -110,13 +228,19 @@ namespace esphome
             optional<FanMode> fan_mode;
             optional<SwingMode> swing_mode;
             optional<AltMode> alt_mode;
+            std::vector<CustomMessageValue> custom_messages;
+
+            // Takes over all values which are set in other, the values of other win.
+            void merge(const ProtocolRequest &other);
         };
 
         class Protocol
         {
         public:
-            virtual void publish_request(MessageTarget *target, const std::string &address, ProtocolRequest &request) = 0;
+            virtual void publish_request(MessageTarget *target, DeviceAddress address, ProtocolRequest &request) = 0;
             virtual void protocol_update(MessageTarget *target) = 0;
+            // Reads the given message from the device every interval ms. Higher priorities are read first.
+            virtual void add_poll(DeviceAddress address, uint16_t message_number, uint32_t interval, uint8_t priority) = 0;
         };
 
         enum class ProtocolProcessing
@@ -128,17 +252,40 @@ namespace esphome
 
         extern ProtocolProcessing protocol_processing;
 
-        enum class DataResult
+        enum class FrameResult
         {
-            Fill = 0,
-            Clear = 1
+            Incomplete = 0,
+            NonNasa = 1,
+            Nasa = 2,
+            Invalid = 3,
+            NasaCrcError = 4
         };
 
-        DataResult process_data(std::vector<uint8_t> &data, MessageTarget *target);
+        // Resumable framing state machine for both protocols. Bytes are fed one at a time as they
+        // arrive, the parser keeps its position and the expected frame length, and reports which
+        // protocol a frame belongs to once it is complete. Only then the full decode has to run.
+        // The NASA crc is updated with every byte, so a complete frame is already verified.
+        class FrameParser
+        {
+        public:
+            FrameResult feed(uint8_t c);
+            void reset();
+
+            // number of bytes of the current candidate frame which were fed so far
+            uint16_t size() const { return position_; }
+
+        protected:
+            uint16_t position_ = 0;
+            uint16_t nasa_size_ = 0;
+            uint8_t checksum_ = 0;
+            uint8_t non_nasa_checksum_ = 0;
+            uint16_t crc_ = 0;
+            uint16_t nasa_crc_ = 0;
+        };
 
-        Protocol *get_protocol(const std::string &address);
+        DecodeResult process_frame(FrameResult frame, ByteSpan data, MessageTarget *target);
 
-        bool is_nasa_address(const std::string &address);
+        Protocol *get_protocol(DeviceAddress address);
 
         enum class AddressType
         {
@@ -147,7 +294,7 @@ namespace esphome
             Other = 2
         };
 
-        AddressType get_address_type(const std::string &address);
+        AddressType get_address_type(DeviceAddress address);
 
     } // namespace samsung_ac
 } // namespace esphome
@@ -1,4 +1,6 @@
 #include <set>
+#include <algorithm>
+#include <cstdio>
 #include "esphome/core/log.h"
 #include "esphome/core/util.h"
 #include "util.h"
@@ -6,6 +8,7 @@
 #include "debug_mqtt.h"
 
 esphome::samsung_ac::Packet packet_;
+esphome::samsung_ac::DeviceState packet_state_;
 
 namespace esphome
 {
@@ -18,28 +21,23 @@ namespace esphome
             return value - (int)65535 /*uint16 max*/ - 1.0;
         }
 
-#define LOG_MESSAGE(message_name, temp, source, dest)                                                             \
-    if (debug_log_messages)                                                                                       \
-    {                                                                                                             \
-        ESP_LOGW(TAG, "s:%s d:%s " #message_name " %g", source.c_str(), dest.c_str(), static_cast<double>(temp)); \
-    }
-
-        uint16_t crc16(std::vector<uint8_t> &data, int startIndex, int length)
+        uint16_t crc16(ByteSpan data, int startIndex, int length)
         {
             uint16_t crc = 0;
-            for (int index = startIndex; index < startIndex + length; ++index)
-            {
-                crc = crc ^ ((uint16_t)((uint8_t)data[index]) << 8);
-                for (uint8_t i = 0; i < 8; i++)
-                {
-                    if (crc & 0x8000)
-                        crc = (crc << 1) ^ 0x1021;
-                    else
-                        crc <<= 1;
-                }
-            }
+            const uint8_t *p = data.data + startIndex;
+#ifndef USE_ESP8266
+            for (; length >= 4; length -= 4, p += 4)
+            {
+                crc = crc16_table[3][(crc >> 8) ^ p[0]] ^
+                      crc16_table[2][(crc & 0xFF) ^ p[1]] ^
+                      crc16_table[1][p[2]] ^
+                      crc16_table[0][p[3]];
+            }
+#endif
+            for (; length > 0; length--, p++)
+                crc = crc16_update(crc, *p);
             return crc;
-        };
+        }
 
         Address Address::get_my_address()
         {
@@ -62,7 +60,21 @@ namespace esphome
             return address;
         }
 
-        void Address::decode(std::vector<uint8_t> &data, unsigned int index)
+        Address Address::unpack(DeviceAddress packed)
+        {
+            Address address;
+            address.klass = (AddressClass)packed.klass();
+            address.channel = packed.channel();
+            address.address = packed.address();
+            return address;
+        }
+
+        DeviceAddress Address::packed() const
+        {
+            return DeviceAddress::nasa((uint8_t)klass, channel, address);
+        }
+
+        void Address::decode(ByteSpan data, unsigned int index)
         {
             klass = (AddressClass)data[index];
             channel = data[index + 1];
@@ -83,7 +95,7 @@ namespace esphome
             return std::string(str);
         }
 
-        void Command::decode(std::vector<uint8_t> &data, unsigned int index)
+        void Command::decode(ByteSpan data, unsigned int index)
         {
             packetInformation = ((int)data[index] & 128) >> 7 == 1;
             protocolVersion = (uint8_t)(((int)data[index] & 96) >> 5);
@@ -114,38 +126,53 @@ namespace esphome
             return str;
         }
 
-        MessageSet MessageSet::decode(std::vector<uint8_t> &data, unsigned int index, int capacity)
+        MessageSet MessageSet::decode(ByteSpan data, unsigned int index)
         {
+            if (index + 2 > data.size)
+            {
+                MessageSet set(MessageNumber::Undefiend);
+                set.size = 0;
+                return set;
+            }
+
             MessageSet set = MessageSet((MessageNumber)((uint32_t)data[index] * 256U + (uint32_t)data[index + 1]));
             switch (set.type)
             {
             case Enum:
-                set.value = (int)data[index + 2];
                 set.size = 3;
                 break;
             case Variable:
-                set.value = (int)data[index + 2] << 8 | (int)data[index + 3];
                 set.size = 4;
                 break;
             case LongVariable:
-                set.value = (int)data[index + 2] << 24 | (int)data[index + 3] << 16 | (int)data[index + 4] << 8 | (int)data[index + 5];
                 set.size = 6;
                 break;
+            case Structure:
+                set.size = data.size - index; // runs until the end of the payload
+                break;
+            }
+
+            if (index + set.size > data.size)
+            {
+                set.size = 0;
+                return set;
+            }
+
+            switch (set.type)
+            {
+            case Enum:
+                set.value = (int)data[index + 2];
+                break;
+            case Variable:
+                set.value = (int)data[index + 2] << 8 | (int)data[index + 3];
+                break;
+            case LongVariable:
+                set.value = (int)data[index + 2] << 24 | (int)data[index + 3] << 16 | (int)data[index + 4] << 8 | (int)data[index + 5];
+                break;
 
             case Structure:
-                if (capacity != 1)
-                {
-                    ESP_LOGE(TAG, "structure messages can only have one message but is %d", capacity);
-                    return set;
-                }
-                Buffer buffer;
-                set.size = data.size() - index - 3; // 3=end bytes
-                buffer.size = set.size - 2;
-                for (int i = 0; i < buffer.size; i++)
-                {
-                    buffer.data[i] = data[i];
-                }
-                set.structure = buffer;
+                set.structure.data = data.data + index + 2;
+                set.structure.size = set.size - 2;
                 break;
             default:
                 ESP_LOGE(TAG, "Unkown type");
@@ -170,10 +197,10 @@ namespace esphome
                 data.push_back((uint8_t)(value & 0xff));
                 break;
             case LongVariable:
-                data.push_back((uint8_t)(value & 0x000000ff));
-                data.push_back((uint8_t)((value & 0x0000ff00) >> 8));
-                data.push_back((uint8_t)((value & 0x00ff0000) >> 16));
                 data.push_back((uint8_t)((value & 0xff000000) >> 24));
+                data.push_back((uint8_t)((value & 0x00ff0000) >> 16));
+                data.push_back((uint8_t)((value & 0x0000ff00) >> 8));
+                data.push_back((uint8_t)(value & 0x000000ff));
                 break;
 
             case Structure:
@@ -204,40 +231,56 @@ namespace esphome
             }
         }
 
-        static int _packetCounter = 0;
+        std::string MessageSet::structure_text() const
+        {
+            std::string str;
+            if (type != Structure)
+                return str;
 
-        std::vector<Packet> out;
+            for (uint16_t i = 0; i < structure.size && structure.data[i] != 0; i++)
+            {
+                const uint8_t c = structure.data[i];
+                str += (c >= 0x20 && c < 0x7f) ? (char)c : '.';
+            }
+            return str;
+        }
 
-        /*
-                class OutgoingPacket
-                {
-                public:
-                    OutgoingPacket(uint32_t timeout_seconds, Packet packet)
-                    {
-                        this->timeout_mili = millis() + (timeout_seconds * 1000);
-                        Packet = packet;
-                    }
+        std::string MessageSet::structure_hex() const
+        {
+            if (type != Structure)
+                return "";
+            return bytes_to_hex(ByteSpan(structure.data, structure.size));
+        }
 
-                    // std::function<void(float)> Func;
-                    Packet Packet;
+        std::string MessageSet::get_option_basic() const
+        {
+            if (messageNumber != MessageNumber::STR_ad_option_basic)
+                return "";
+            return structure_hex();
+        }
 
-                    bool IsTimedout()
-                    {
-                        return timeout_mili < millis();
-                    };
+        std::string MessageSet::get_dbcode_micom_main() const
+        {
+            if (messageNumber != MessageNumber::STR_ad_dbcode_micom_main)
+                return "";
+            return structure_text();
+        }
+
+        std::string MessageSet::get_inverter_and_bootloader_info() const
+        {
+            if (messageNumber != MessageNumber::STR_out_install_inverter_and_bootloader_info)
+                return "";
+            return structure_text();
+        }
+
+        static int _packetCounter = 0;
 
-                private:
-                    uint32_t timeout_mili{0}; // millis();
-                };
-        */
         Packet Packet::create(Address da, DataType dataType, MessageNumber messageNumber, int value)
         {
             Packet packet = createa_partial(da, dataType);
             MessageSet message(messageNumber);
             message.value = value;
             packet.messages.push_back(message);
-            out.push_back(packet);
-
             return packet;
         }
 
@@ -253,27 +296,30 @@ namespace esphome
             return packet;
         }
 
-        DecodeResult Packet::decode(std::vector<uint8_t> &data)
+        DecodeResult Packet::decode(ByteSpan data, bool verify_crc)
         {
+            if (data.size < 16 || data.size > 1500)
+                return DecodeResult::UnexpectedSize;
+
             if (data[0] != 0x32)
                 return DecodeResult::InvalidStartByte;
 
-            if (data.size() < 16 || data.size() > 1500)
-                return DecodeResult::UnexpectedSize;
-
             int size = (int)data[1] << 8 | (int)data[2];
-            if (size + 2 != data.size())
+            if (size + 2 != data.size)
                 return DecodeResult::SizeDidNotMatch;
 
-            if (data[data.size() - 1] != 0x34)
+            if (data[data.size - 1] != 0x34)
                 return DecodeResult::InvalidEndByte;
 
-            uint16_t crc_actual = crc16(data, 3, size - 4);
-            uint16_t crc_expected = (int)data[data.size() - 3] << 8 | (int)data[data.size() - 2];
-            if (crc_expected != crc_actual)
+            if (verify_crc)
             {
-                ESP_LOGW(TAG, "NASA: invalid crc - got %d but should be %d: %s", crc_actual, crc_expected, bytes_to_hex(data).c_str());
-                return DecodeResult::CrcError;
+                uint16_t crc_actual = crc16(data, 3, size - 4);
+                uint16_t crc_expected = (int)data[data.size - 3] << 8 | (int)data[data.size - 2];
+                if (crc_expected != crc_actual)
+                {
+                    ESP_LOGW(TAG, "NASA: invalid crc - got %d but should be %d: %s", crc_actual, crc_expected, bytes_to_hex(data).c_str());
+                    return DecodeResult::CrcError;
+                }
             }
 
             unsigned int cursor = 3;
@@ -290,10 +336,25 @@ namespace esphome
             int capacity = (int)data[cursor];
             cursor++;
 
+            // the capacity can be corrupt, so messages must never be read beyond the crc
+            const ByteSpan payload = data.first(data.size - 3);
+
+            // clear() keeps the allocated capacity, so decoding does not allocate once warmed up
             messages.clear();
             for (int i = 1; i <= capacity; ++i)
             {
-                MessageSet set = MessageSet::decode(data, cursor, capacity);
+                MessageSet set = MessageSet::decode(payload, cursor);
+                if (set.size == 0)
+                {
+                    ESP_LOGW(TAG, "NASA: message %d of %d exceeds the packet size: %s", i, capacity, bytes_to_hex(data).c_str());
+                    return DecodeResult::UnexpectedSize;
+                }
+                // a structure takes the rest of the payload, so it can only be the last message
+                if (set.type == Structure && i != capacity)
+                {
+                    ESP_LOGW(TAG, "NASA: structure message %d of %d is not the last one: %s", i, capacity, bytes_to_hex(data).c_str());
+                    return DecodeResult::UnexpectedSize;
+                }
                 messages.push_back(set);
                 cursor += set.size;
             }
@@ -370,9 +431,9 @@ namespace esphome
             }
         }
 
-        void NasaProtocol::publish_request(MessageTarget *target, const std::string &address, ProtocolRequest &request)
+        void NasaProtocol::publish_request(MessageTarget *target, DeviceAddress address, ProtocolRequest &request)
         {
-            Packet packet = Packet::createa_partial(Address::parse(address), DataType::Request);
+            Packet packet = Packet::createa_partial(Address::unpack(address), DataType::Request);
 
             if (request.mode)
             {
@@ -459,15 +520,234 @@ namespace esphome
                 packet.messages.push_back(lr_swing);
             }
 
+            for (const auto &custom : request.custom_messages)
+            {
+                MessageSet message((MessageNumber)custom.message_number);
+                if (message.type == Structure)
+                {
+                    ESP_LOGW(TAG, "cannot write structure message 0x%04x", custom.message_number);
+                    continue;
+                }
+                message.value = custom.value;
+                packet.messages.push_back(message);
+            }
+
             if (packet.messages.size() == 0)
                 return;
 
             ESP_LOGW(TAG, "publish packet %s", packet.to_string().c_str());
 
-            out.push_back(packet);
+            nasa_transactions.add(target, packet);
+
+            auto data = packet.encode();
+            target->publish_data(data, TxPriority::Control);
+        }
+
+        NasaTransactionTable nasa_transactions;
+
+        NasaSequenceTracker nasa_sequence_tracker;
+
+        bool NasaSequenceTracker::track(DeviceAddress source, uint8_t packet_number, uint8_t retry_count, uint32_t now)
+        {
+            Source *slot = nullptr;
+            for (auto &entry : sources_)
+            {
+                if (entry.used && entry.address == source)
+                {
+                    slot = &entry;
+                    break;
+                }
+                if (slot == nullptr || !entry.used || (slot->used && (int32_t)(entry.last_seen - slot->last_seen) < 0))
+                    slot = &entry;
+            }
+
+            stats_.received++;
+            if (!slot->used || slot->address != source)
+            {
+                slot->used = true;
+                slot->address = source;
+            }
+            else if (packet_number == slot->packet_number && retry_count > 0)
+            {
+                stats_.duplicates++;
+                slot->last_seen = now;
+                return false;
+            }
+            else
+            {
+                const uint8_t gap = packet_number - slot->packet_number - 1;
+                if (gap > 0 && gap <= MAX_GAP)
+                {
+                    ESP_LOGD(TAG, "missed %d packets from %s", gap, source.to_string().c_str());
+                    stats_.missing += gap;
+                }
+            }
+
+            slot->packet_number = packet_number;
+            slot->last_seen = now;
+            return true;
+        }
+
+        void NasaSequenceTracker::clear()
+        {
+            for (auto &entry : sources_)
+                entry.used = false;
+            stats_ = NasaSequenceStats();
+        }
+
+        NasaPollScheduler nasa_poll_scheduler;
+
+        void NasaPollScheduler::add(DeviceAddress address, uint16_t message_number, uint32_t interval, uint8_t priority)
+        {
+            if (MessageSet((MessageNumber)message_number).type == MessageSetType::Structure)
+            {
+                ESP_LOGW(TAG, "structure message 0x%04x can not be polled", message_number);
+                return;
+            }
+
+            Poll poll;
+            poll.address = address;
+            poll.message_number = message_number;
+            poll.priority = priority;
+            poll.interval = interval;
+
+            auto it = std::upper_bound(polls_.begin(), polls_.end(), priority, [](uint8_t priority, const Poll &p)
+                                       { return priority > p.priority; });
+            polls_.insert(it, poll);
+        }
+
+        bool NasaPollScheduler::update(MessageTarget *target, uint32_t now)
+        {
+            // the device of the most important due message is polled
+            auto first = std::find_if(polls_.begin(), polls_.end(), [now](const Poll &poll)
+                                      { return poll.due(now); });
+            if (first == polls_.end())
+                return false;
+
+            const DeviceAddress address = first->address;
+            Packet packet = Packet::createa_partial(Address::unpack(address), DataType::Read);
+
+            size_t size = 16; // start, size, addresses, command, capacity, crc and end byte
+            for (auto it = first; it != polls_.end() && packet.messages.size() < MAX_MESSAGES; ++it)
+            {
+                if (it->address != address || !it->due(now))
+                    continue;
+
+                MessageSet message((MessageNumber)it->message_number);
+                message.value = 0;
+                const size_t message_size = 2 + (message.type == MessageSetType::Enum ? 1 : message.type == MessageSetType::Variable ? 2
+                                                                                                                                      : 4);
+                if (size + message_size > MAX_PACKET_SIZE)
+                    break;
+
+                size += message_size;
+                packet.messages.push_back(message);
+                it->polled = true;
+                it->last_poll = now;
+            }
+
+            ESP_LOGD(TAG, "poll %d messages from %s", (int)packet.messages.size(), address.to_string().c_str());
+            nasa_transactions.add(target, packet);
 
             auto data = packet.encode();
-            target->publish_data(data);
+            target->publish_data(data, TxPriority::Poll);
+            return true;
+        }
+
+        void NasaTransactionTable::add(MessageTarget *target, const Packet &packet)
+        {
+            const uint32_t now = target->get_miliseconds();
+            Transaction *slot = nullptr;
+            for (auto &transaction : transactions_)
+            {
+                if (!transaction.used)
+                {
+                    slot = &transaction;
+                    break;
+                }
+                if (slot == nullptr || (int32_t)(transaction.first_sent - slot->first_sent) < 0)
+                    slot = &transaction;
+            }
+
+            if (slot->used)
+            {
+                ESP_LOGW(TAG, "transaction table full, dropping packet %d", slot->packet.command.packetNumber);
+                stats_.expired++;
+            }
+
+            slot->used = true;
+            slot->dest = packet.da.packed();
+            slot->first_sent = now;
+            slot->last_sent = now;
+            slot->packet = packet;
+            slot->timer.callback = [this, slot, target]()
+            { timeout(target, *slot); };
+            target->get_timers().schedule(slot->timer, now + TIMEOUT);
+        }
+
+        bool NasaTransactionTable::complete(DeviceAddress source, uint8_t packet_number, bool success, uint32_t now)
+        {
+            for (auto &transaction : transactions_)
+            {
+                if (!transaction.used || transaction.packet.command.packetNumber != packet_number || transaction.dest != source)
+                    continue;
+
+                const uint32_t rtt = now - transaction.last_sent;
+                stats_.last_rtt = rtt;
+                stats_.max_rtt = std::max(stats_.max_rtt, rtt);
+                if (success)
+                    stats_.completed++;
+                else
+                    stats_.nacked++;
+
+                ESP_LOGD(TAG, "packet %d %s by %s after %u ms (%d retries)", packet_number, success ? "acknowledged" : "rejected",
+                         source.to_string().c_str(), (unsigned)rtt, transaction.packet.command.retryCount);
+
+                transaction.used = false;
+                transaction.timer.cancel();
+                return true;
+            }
+            return false;
+        }
+
+        void NasaTransactionTable::timeout(MessageTarget *target, Transaction &transaction)
+        {
+            if (transaction.packet.command.retryCount >= MAX_RETRIES)
+            {
+                ESP_LOGW(TAG, "packet %d to %s expired without reply", transaction.packet.command.packetNumber, transaction.dest.to_string().c_str());
+                stats_.expired++;
+                transaction.used = false;
+                return;
+            }
+
+            const uint32_t now = target->get_miliseconds();
+            transaction.packet.command.retryCount++;
+            transaction.last_sent = now;
+            stats_.retries++;
+            target->get_timers().schedule(transaction.timer, now + TIMEOUT);
+
+            ESP_LOGD(TAG, "resend packet %d to %s (retry %d)", transaction.packet.command.packetNumber, transaction.dest.to_string().c_str(), transaction.packet.command.retryCount);
+            auto data = transaction.packet.encode();
+            target->publish_data(data, transaction.packet.command.dataType == DataType::Read ? TxPriority::Poll : TxPriority::Control);
+        }
+
+        void NasaTransactionTable::clear()
+        {
+            for (auto &transaction : transactions_)
+            {
+                transaction.used = false;
+                transaction.timer.cancel();
+            }
+            stats_ = NasaTransactionStats();
+        }
+
+        size_t NasaTransactionTable::size() const
+        {
+            size_t size = 0;
+            for (const auto &transaction : transactions_)
+                if (transaction.used)
+                    size++;
+            return size;
         }
 
         Mode operation_mode_to_mode(int value)
@@ -538,8 +818,162 @@ namespace esphome
             }
         }
 
-        void process_messageset(std::string source, std::string dest, MessageSet &message, MessageTarget *target)
+        FanMode fan_mode_to_fanmode(long value)
+        {
+            switch (value)
+            {
+            case 0:
+                return FanMode::Auto;
+            case 1:
+                return FanMode::Low;
+            case 2:
+                return FanMode::Mid;
+            case 3:
+                return FanMode::High;
+            case 4:
+                return FanMode::Turbo;
+            default:
+                return FanMode::Unknown;
+            }
+        }
+
+        // All known messages, sorted by number. Messages without handler are only logged.
+        // Names and scales are taken from the NASA XML where available.
+        static constexpr MessageInfo message_registry[] = {
+            {0x0600, "STR_ad_option_basic", 1, false, nullptr},
+            {0x0608, "STR_ad_dbcode_micom_main", 1, false, nullptr},
+            {0x4000, "ENUM_in_operation_power", 1, false, [](DeviceState &state, long raw, double)
+             { state.power = raw != 0; }},
+            {0x4001, "ENUM_in_operation_mode", 1, false, [](DeviceState &state, long raw, double)
+             { state.mode = operation_mode_to_mode(raw); }},
+            {0x4002, "ENUM_in_operation_mode_real", 1, false, nullptr},
+            {0x4003, "ENUM_in_operation_vent_power", 1, false, nullptr},
+            {0x4004, "ENUM_in_operation_vent_mode", 1, false, nullptr},
+            {0x4006, "ENUM_in_fan_mode", 1, false, [](DeviceState &state, long raw, double)
+             { state.fanmode = fan_mode_to_fanmode(raw); }},
+            {0x4007, "ENUM_in_fan_mode_real", 1, false, nullptr},
+            {0x4008, "ENUM_in_fan_vent_mode", 1, false, nullptr},
+            {0x4011, "ENUM_in_louver_hl_swing", 1, false, [](DeviceState &state, long raw, double)
+             { state.swing_vertical = raw == 1; }},
+            {0x4012, "ENUM_in_louver_hl_part_swing", 1, false, nullptr},
+            {0x4038, "ENUM_in_state_humidity_percent", 1, false, nullptr},
+            {0x4060, "ENUM_in_alt_mode", 1, false, [](DeviceState &state, long raw, double)
+             { state.altmode = (AltMode)raw; }},
+            {0x4065, "ENUM_in_water_heater_power", 1, false, [](DeviceState &state, long raw, double)
+             { state.water_heater_power = raw != 0; }},
+            {0x4066, "ENUM_in_water_heater_mode", 1, false, [](DeviceState &state, long raw, double)
+             { state.water_heater_mode = water_heater_mode_to_waterheatermode(raw); }},
+            {0x406E, "ENUM_in_quiet_mode", 1, false, nullptr},
+            {0x407E, "ENUM_in_louver_lr_swing", 1, false, [](DeviceState &state, long raw, double)
+             { state.swing_horizontal = raw == 1; }},
+            {0x4111, "ENUM_in_operation_automatic_cleaning", 1, false, [](DeviceState &state, long raw, double)
+             { state.automatic_cleaning = raw != 0; }},
+            {0x4119, "ENUM_in_operation_power_zone1", 1, false, nullptr},
+            {0x411E, "ENUM_in_operation_power_zone2", 1, false, nullptr},
+            {0x4201, "VAR_in_temp_target_f", 10, false, [](DeviceState &state, long, double value)
+             { state.target_temperature = value; }},
+            {0x4203, "VAR_in_temp_room_f", 10, false, [](DeviceState &state, long, double value)
+             { state.room_temperature = value; }},
+            {0x4205, "VAR_in_temp_eva_in_f", 10, true, [](DeviceState &state, long, double value)
+             { state.indoor_eva_in_temperature = value; }},
+            {0x4206, "VAR_in_temp_eva_out_f", 10, true, [](DeviceState &state, long, double value)
+             { state.indoor_eva_out_temperature = value; }},
+            {0x4211, "VAR_in_capacity_request", 1, false, nullptr},
+            {0x4235, "VAR_in_temp_water_heater_target_f", 10, false, [](DeviceState &state, long, double value)
+             { state.target_water_temperature = value; }},
+            {0x4237, "VAR_in_temp_water_tank_f", 10, true, nullptr},
+            {0x4247, "VAR_in_temp_water_outlet_target_f", 10, false, [](DeviceState &state, long, double value)
+             { state.water_outlet_target = value; }},
+            {0x4260, "VAR_IN_FSV_3021", 10, false, nullptr},
+            {0x4261, "VAR_IN_FSV_3022", 10, false, nullptr},
+            {0x4262, "VAR_IN_FSV_3023", 10, false, nullptr},
+            {0x42D1, "VAR_IN_DUST_SENSOR_PM10_0_VALUE", 1, false, nullptr},
+            {0x42D2, "VAR_IN_DUST_SENSOR_PM2_5_VALUE", 1, false, nullptr},
+            {0x42D3, "VAR_IN_DUST_SENSOR_PM1_0_VALUE", 1, false, nullptr},
+            {0x8001, "ENUM_out_operation_odu_mode", 1, false, nullptr},
+            {0x8003, "ENUM_out_operation_heatcool", 1, false, nullptr},
+            {0x801A, "ENUM_out_load_4way", 1, false, nullptr},
+            {0x8204, "VAR_out_sensor_airout", 10, true, [](DeviceState &state, long, double value)
+             { state.outdoor_temperature = value; }},
+            {0x8235, "VAR_out_error_code", 1, false, [](DeviceState &state, long raw, double)
+             { state.error_code = (int)raw; }},
+            {0x8261, "VAR_OUT_SENSOR_PIPEIN3", 10, false, nullptr},
+            {0x8262, "VAR_OUT_SENSOR_PIPEIN4", 10, false, nullptr},
+            {0x8263, "VAR_OUT_SENSOR_PIPEIN5", 10, false, nullptr},
+            {0x8264, "VAR_OUT_SENSOR_PIPEOUT1", 10, false, nullptr},
+            {0x8265, "VAR_OUT_SENSOR_PIPEOUT2", 10, false, nullptr},
+            {0x8266, "VAR_OUT_SENSOR_PIPEOUT3", 10, false, nullptr},
+            {0x8267, "VAR_OUT_SENSOR_PIPEOUT4", 10, false, nullptr},
+            {0x8268, "VAR_OUT_SENSOR_PIPEOUT5", 10, false, nullptr},
+            {0x8274, "VAR_out_control_order_cfreq_comp2", 1, false, nullptr},
+            {0x8275, "VAR_out_control_target_cfreq_comp2", 1, false, nullptr},
+            {0x8280, "VAR_out_sensor_top1", 10, false, nullptr},
+            {0x82BC, "VAR_OUT_PROJECT_CODE", 1, false, nullptr},
+            {0x82DB, "VAR_OUT_PHASE_CURRENT", 1, false, nullptr},
+            {0x82E3, "VAR_OUT_PRODUCT_OPTION_CAPA", 1, false, nullptr},
+            {0x8411, "NASA_OUTDOOR_CONTROL_WATTMETER_1UNIT", 1, false, nullptr},
+            {0x8413, "LVAR_OUT_CONTROL_WATTMETER_1W_1MIN_SUM", 1, false, nullptr},
+            {0x8414, "LVAR_OUT_CONTROL_WATTMETER_ALL_UNIT_ACCUM", 1000, false, nullptr},
+            {0x8415, "NASA_OUTDOOR_CONTROL_WATTMETER_TOTAL_SUM", 1, false, nullptr},
+            {0x8416, "NASA_OUTDOOR_CONTROL_WATTMETER_TOTAL_SUM_ACCUM", 1, false, nullptr},
+            {0x8426, "actual_produced_energy", 1, false, nullptr},
+            {0x8427, "total_produced_energy", 1, false, nullptr},
+            {0x8601, "STR_out_install_inverter_and_bootloader_info", 1, false, nullptr},
+        };
+
+        constexpr bool is_message_registry_sorted()
+        {
+            for (size_t i = 1; i < sizeof(message_registry) / sizeof(message_registry[0]); i++)
+            {
+                if (message_registry[i - 1].number >= message_registry[i].number)
+                    return false;
+            }
+            return true;
+        }
+
+        static_assert(is_message_registry_sorted(), "message_registry must be sorted by number");
+
+        const MessageInfo *find_message_info(MessageNumber number)
+        {
+            size_t low = 0;
+            size_t high = sizeof(message_registry) / sizeof(message_registry[0]);
+            while (low < high)
+            {
+                const size_t mid = (low + high) / 2;
+                if (message_registry[mid].number < (uint16_t)number)
+                    low = mid + 1;
+                else
+                    high = mid;
+            }
+            if (low < sizeof(message_registry) / sizeof(message_registry[0]) && message_registry[low].number == (uint16_t)number)
+                return &message_registry[low];
+            return nullptr;
+        }
+
+        double MessageInfo::to_value(long raw) const
         {
+            if (is_signed)
+            {
+                switch (type())
+                {
+                case Enum:
+                    raw = (int8_t)raw;
+                    break;
+                case Variable:
+                    raw = (int16_t)raw;
+                    break;
+                default:
+                    raw = (int32_t)raw;
+                    break;
+                }
+            }
+            return (double)raw / divisor;
+        }
+
+        void process_messageset(DeviceAddress source, DeviceAddress dest, MessageSet &message, DeviceState &state)
+        {
+            const MessageInfo *info = find_message_info(message.messageNumber);
+
             if (debug_mqtt_connected())
             {
                 static const std::string topic_prefix = "samsung_ac/nasa/";
@@ -549,7 +983,7 @@ namespace esphome
                 if (static_cast<int>(message.messageNumber) != 0)
                 {
                     topic_suffix = long_to_hex((uint16_t)message.messageNumber);
-                    payload = std::to_string(message.value);
+                    payload = message.type == MessageSetType::Structure ? message.structure_hex() : std::to_string(message.value);
                 }
                 else
                 {
@@ -568,231 +1002,79 @@ namespace esphome
                 case MessageSetType::LongVariable:
                     debug_mqtt_publish(topic_prefix + "var_long/" + topic_suffix, payload);
                     break;
+                case MessageSetType::Structure:
+                    debug_mqtt_publish(topic_prefix + "str/" + topic_suffix, payload);
+                    break;
                 default:
                     break;
                 }
-            }
-
-            target->set_custom_sensor(source, (uint16_t)message.messageNumber, (float)message.value);
 
-            switch (message.messageNumber)
-            {
-            case MessageNumber::VAR_in_temp_room_f: // unit = 'Celsius' from XML
-            {
-                double temp = (double)message.value / (double)10;
-                LOG_MESSAGE(VAR_in_temp_room_f, temp, source, dest);
-                target->set_room_temperature(source, temp);
-                break;
-            }
-            case MessageNumber::VAR_in_temp_target_f: // unit = 'Celsius' from XML
-            {
-                double temp = (double)message.value / (double)10;
-                LOG_MESSAGE(VAR_in_temp_target_f, temp, source, dest);
-                target->set_target_temperature(source, temp);
-                break;
-            }
-            case MessageNumber::VAR_in_temp_water_outlet_target_f: // unit = 'Celsius' from XML
-            {
-                double temp = (double)message.value / (double)10;
-                LOG_MESSAGE(VAR_in_temp_water_outlet_target_f, temp, source, dest);
-                target->set_water_outlet_target(source, temp);
-                break;
-            }
-            case MessageNumber::VAR_in_temp_water_heater_target_f: // unit = 'Celsius' from XML
-            {
-                double temp = (double)message.value / (double)10;
-                LOG_MESSAGE(VAR_in_temp_water_heater_target_f, temp, source, dest);
-                target->set_target_water_temperature(source, temp);
-                break;
-            }
-            case MessageNumber::ENUM_in_state_humidity_percent:
-            {
-                LOG_MESSAGE(ENUM_in_state_humidity_percent, (double)message.value, source, dest);
-                break;
-            }
-            case MessageNumber::ENUM_in_operation_power:
-            {
-                LOG_MESSAGE(ENUM_in_operation_power, (double)message.value, source, dest);
-                target->set_power(source, message.value != 0);
-                break;
-            }
-            case MessageNumber::ENUM_in_operation_automatic_cleaning:
-            {
-                LOG_MESSAGE(ENUM_in_operation_automatic_cleaning, (double)message.value, source, dest);
-                target->set_automatic_cleaning(source, message.value != 0);
-                break;
-            }
-            case MessageNumber::ENUM_in_water_heater_power:
-            {
-                LOG_MESSAGE(ENUM_in_water_heater_power, (double)message.value, source, dest);
-                target->set_water_heater_power(source, message.value != 0);
-                break;
-            }
-            case MessageNumber::ENUM_in_operation_mode:
-            {
-                LOG_MESSAGE(ENUM_in_operation_mode, (double)message.value, source, dest);
-                target->set_mode(source, operation_mode_to_mode(message.value));
-                break;
-            }
-            case MessageNumber::ENUM_in_water_heater_mode:
-            {
-                LOG_MESSAGE(ENUM_in_water_heater_mode, (double)message.value, source, dest);
-                target->set_water_heater_mode(source, water_heater_mode_to_waterheatermode(message.value));
-                return;
-            }
-            case MessageNumber::ENUM_in_fan_mode:
-            {
-                LOG_MESSAGE(ENUM_in_fan_mode, (double)message.value, source, dest);
-                FanMode mode = FanMode::Unknown;
-                if (message.value == 0)
-                    mode = FanMode::Auto;
-                else if (message.value == 1)
-                    mode = FanMode::Low;
-                else if (message.value == 2)
-                    mode = FanMode::Mid;
-                else if (message.value == 3)
-                    mode = FanMode::High;
-                else if (message.value == 4)
-                    mode = FanMode::Turbo;
-                target->set_fanmode(source, mode);
-                break;
-            }
-            case MessageNumber::ENUM_in_fan_mode_real:
-            {
-                LOG_MESSAGE(ENUM_in_fan_mode_real, (double)message.value, source, dest);
-                break;
-            }
-            case MessageNumber::ENUM_in_alt_mode:
-            {
-                LOG_MESSAGE(ENUM_in_alt_mode, (double)message.value, source, dest);
-                target->set_altmode(source, message.value);
-                break;
-            }
-            case MessageNumber::ENUM_in_louver_hl_swing:
-            {
-                LOG_MESSAGE(ENUM_in_louver_hl_swing, (double)message.value, source, dest);
-                target->set_swing_vertical(source, message.value == 1);
-                break;
-            }
-            case MessageNumber::ENUM_in_louver_lr_swing:
-            {
-                LOG_MESSAGE(ENUM_in_louver_lr_swing, (double)message.value, source, dest);
-                target->set_swing_horizontal(source, message.value == 1);
-                break;
-            }
-            case MessageNumber::VAR_in_temp_water_tank_f:
-            {
-                LOG_MESSAGE(VAR_in_temp_water_tank_f, (double)message.value, source, dest);
-                break;
-            }
-            case MessageNumber::VAR_out_sensor_airout:
-            {
-                double temp = (double)((int16_t)message.value) / (double)10;
-                LOG_MESSAGE(VAR_out_sensor_airout, temp, source, dest);
-                target->set_outdoor_temperature(source, temp);
-                break;
-            }
-            case MessageNumber::VAR_in_temp_eva_in_f:
-            {
-                double temp = ((int16_t)message.value) / 10.0;
-                LOG_MESSAGE(VAR_in_temp_eva_in_f, temp, source, dest);
-                target->set_indoor_eva_in_temperature(source, temp);
-                break;
-            }
-            case MessageNumber::VAR_in_temp_eva_out_f:
-            {
-                double temp = ((int16_t)message.value) / 10.0;
-                LOG_MESSAGE(VAR_in_temp_eva_out_f, temp, source, dest);
-                target->set_indoor_eva_out_temperature(source, temp);
-                break;
-            }
-            case MessageNumber::VAR_out_error_code:
-            {
-                int code = static_cast<int>(message.value);
-                if (debug_log_messages)
+                // known messages are also published by name with the scaled value
+                if (info != nullptr && message.type != MessageSetType::Structure)
                 {
-                    ESP_LOGW(TAG, "s:%s d:%s VAR_out_error_code %d", source.c_str(), dest.c_str(), code);
+                    char value[24];
+                    snprintf(value, sizeof(value), "%g", info->to_value(message.value));
+                    debug_mqtt_publish(topic_prefix + info->name, value);
                 }
-                target->set_error_code(source, code);
-                break;
             }
 
-            default:
+            if (message.type == MessageSetType::Structure)
             {
-                double value = 0;
-                switch ((uint16_t)message.messageNumber)
+                switch (message.messageNumber)
                 {
-                case 0x4260:
-                    value = (double)message.value / 10.0;
-                    LOG_MESSAGE(VAR_IN_FSV_3021, value, source, dest);
-                    break;
-
-                case 0x4261:
-                    value = (double)message.value / 10.0;
-                    LOG_MESSAGE(VAR_IN_FSV_3022, value, source, dest);
-                    break;
-
-                case 0x4262:
-                    value = (double)message.value / 10.0;
-                    LOG_MESSAGE(VAR_IN_FSV_3023, value, source, dest);
-                    break;
-
-                case 0x8414:
-                    value = (double)message.value / 1000.0;
-                    LOG_MESSAGE(LVAR_OUT_CONTROL_WATTMETER_ALL_UNIT_ACCUM, value, source, dest);
-                    break;
-
-                case 0x8413:
-                    value = (double)message.value;
-                    LOG_MESSAGE(LVAR_OUT_CONTROL_WATTMETER_1W_1MIN_SUM, value, source, dest);
-                    break;
-
-                case 0x8411:
-                    value = (double)message.value;
-                    LOG_MESSAGE(NASA_OUTDOOR_CONTROL_WATTMETER_1UNIT, value, source, dest);
-                    break;
-
-                case 0x8427:
-                    value = (double)message.value;
-                    LOG_MESSAGE(total_produced_energy, value, source, dest);
-                    break;
-
-                case 0x8426:
-                    value = (double)message.value;
-                    LOG_MESSAGE(actual_produced_energy, value, source, dest);
+                case MessageNumber::STR_ad_option_basic:
+                    ESP_LOGI(TAG, "s:%s d:%s option code: %s", source.to_string().c_str(), dest.to_string().c_str(), message.get_option_basic().c_str());
                     break;
-
-                case 0x8415:
-                    value = (double)message.value;
-                    LOG_MESSAGE(NASA_OUTDOOR_CONTROL_WATTMETER_TOTAL_SUM, value, source, dest);
+                case MessageNumber::STR_ad_dbcode_micom_main:
+                    ESP_LOGI(TAG, "s:%s d:%s micom db code: %s", source.to_string().c_str(), dest.to_string().c_str(), message.get_dbcode_micom_main().c_str());
                     break;
-
-                case 0x8416:
-                    value = (double)message.value;
-                    LOG_MESSAGE(NASA_OUTDOOR_CONTROL_WATTMETER_TOTAL_SUM_ACCUM, value, source, dest);
+                case MessageNumber::STR_out_install_inverter_and_bootloader_info:
+                    ESP_LOGI(TAG, "s:%s d:%s inverter and bootloader info: %s", source.to_string().c_str(), dest.to_string().c_str(), message.get_inverter_and_bootloader_info().c_str());
                     break;
-
                 default:
                     if (debug_log_undefined_messages)
                     {
-                        ESP_LOGW(TAG, "Undefined s:%s d:%s %s", source.c_str(), dest.c_str(), message.to_string().c_str());
+                        ESP_LOGW(TAG, "Undefined s:%s d:%s %s %s", source.to_string().c_str(), dest.to_string().c_str(), message.to_string().c_str(), message.structure_hex().c_str());
                     }
                     break;
                 }
-                break;
+                return;
+            }
+
+            if (custom_message_subscriptions.contains(source, (uint16_t)message.messageNumber))
+            {
+                const float raw = (float)message.value;
+                state.custom_sensors.push_back({(uint16_t)message.messageNumber, raw, info != nullptr ? (float)info->to_value(message.value) : raw});
+            }
+
+            if (info == nullptr)
+            {
+                if (debug_log_undefined_messages)
+                {
+                    ESP_LOGW(TAG, "Undefined s:%s d:%s %s", source.to_string().c_str(), dest.to_string().c_str(), message.to_string().c_str());
+                }
+                return;
             }
+
+            const double value = info->to_value(message.value);
+            if (debug_log_messages)
+            {
+                ESP_LOGW(TAG, "s:%s d:%s %s %g", source.to_string().c_str(), dest.to_string().c_str(), info->name, value);
             }
+
+            if (info->handler != nullptr)
+                info->handler(state, message.value, value);
         }
 
-        DecodeResult try_decode_nasa_packet(std::vector<uint8_t> data)
+        DecodeResult try_decode_nasa_packet(ByteSpan data, bool verify_crc)
         {
-            return packet_.decode(data);
+            return packet_.decode(data, verify_crc);
         }
 
         void process_nasa_packet(MessageTarget *target)
         {
-            const auto source = packet_.sa.to_string();
-            const auto dest = packet_.da.to_string();
+            const DeviceAddress source = packet_.sa.packed();
+            const DeviceAddress dest = packet_.da.packed();
 
             target->register_address(source);
 
@@ -801,30 +1083,36 @@ namespace esphome
                 ESP_LOGW(TAG, "MSG: %s", packet_.to_string().c_str());
             }
 
-            if (packet_.command.dataType == DataType::Ack)
+            if (packet_.command.dataType == DataType::Notification || packet_.command.dataType == DataType::Request ||
+                packet_.command.dataType == DataType::Read || packet_.command.dataType == DataType::Write)
             {
-                for (int i = 0; i < out.size(); i++)
+                if (!nasa_sequence_tracker.track(source, packet_.command.packetNumber, packet_.command.retryCount, target->get_miliseconds()))
                 {
-                    if (out[i].command.packetNumber == packet_.command.packetNumber)
-                    {
-                        ESP_LOGW(TAG, "found %d", out[i].command.packetNumber);
-                        out.erase(out.begin() + i);
-                        break;
-                    }
+                    ESP_LOGV(TAG, "skipping retransmitted packet %d from %s", packet_.command.packetNumber, source.to_string().c_str());
+                    return;
                 }
+            }
 
-                ESP_LOGW(TAG, "Ack %s s %d", packet_.to_string().c_str(), out.size());
-                return;
+            // every node numbers its packets on its own, so only replies to us can complete our requests
+            if ((packet_.command.dataType == DataType::Ack || packet_.command.dataType == DataType::Nack ||
+                 packet_.command.dataType == DataType::Response) &&
+                packet_.da.packed() == Address::get_my_address().packed())
+            {
+                const bool success = packet_.command.dataType != DataType::Nack;
+                if (nasa_transactions.complete(source, packet_.command.packetNumber, success, target->get_miliseconds()) &&
+                    packet_.command.dataType != DataType::Response)
+                    return;
             }
 
-            if (packet_.command.dataType == DataType::Request)
+            if (packet_.command.dataType == DataType::Ack)
             {
-                ESP_LOGW(TAG, "Request %s", packet_.to_string().c_str());
+                ESP_LOGW(TAG, "Ack %s", packet_.to_string().c_str());
                 return;
             }
-            if (packet_.command.dataType == DataType::Response)
+
+            if (packet_.command.dataType == DataType::Request)
             {
-                ESP_LOGW(TAG, "Response %s", packet_.to_string().c_str());
+                ESP_LOGW(TAG, "Request %s", packet_.to_string().c_str());
                 return;
             }
             if (packet_.command.dataType == DataType::Write)
@@ -843,374 +1131,27 @@ namespace esphome
                 return;
             }
 
-            if (packet_.command.dataType != DataType::Notification)
+            // responses (e.g. to our Read requests) carry current values just like notifications
+            if (packet_.command.dataType != DataType::Notification && packet_.command.dataType != DataType::Response)
                 return;
 
+            // all messages of a notification belong to its source, apply them at once
+            packet_state_.clear();
             for (auto &message : packet_.messages)
             {
-                process_messageset(source, dest, message, target);
+                process_messageset(source, dest, message, packet_state_);
             }
+            target->set_state(source, packet_state_);
         }
 
-        void process_messageset_debug(std::string source, std::string dest, MessageSet &message, MessageTarget *target)
+        void NasaProtocol::protocol_update(MessageTarget *target)
         {
-            if (source == "20.00.00" || source == "20.00.01" || source == "20.00.02" || source == "20.00.03")
-                return;
-
-            switch ((uint16_t)message.messageNumber)
-            {
-            case 0x4003:
-                LOG_MESSAGE(ENUM_IN_OPERATION_VENT_POWER, message.value, source, dest);
-                break;
-            case 0x4004:
-                LOG_MESSAGE(ENUM_IN_OPERATION_VENT_MODE, message.value, source, dest);
-                break;
-            case 0x4011:
-                LOG_MESSAGE(ENUM_IN_LOUVER_HL_SWING, message.value, source, dest);
-                break;
-            case 0x4012:
-                LOG_MESSAGE(ENUM_in_louver_hl_part_swing, message.value, source, dest);
-                break;
-            case 0x4060:
-                LOG_MESSAGE(ENUM_IN_ALTERNATIVE_MODE, message.value, source, dest);
-                break;
-            case 0x406E:
-                LOG_MESSAGE(ENUM_IN_QUIET_MODE, message.value, source, dest);
-                break;
-            case 0x4119:
-                LOG_MESSAGE(ENUM_IN_OPERATION_POWER_ZONE1, message.value, source, dest);
-                break;
-            case 0x411E:
-                LOG_MESSAGE(ENUM_IN_OPERATION_POWER_ZONE2, message.value, source, dest);
-                break;
-            case 0x4002: // ENUM_in_operation_mode_real
-                // Todo Map
-                LOG_MESSAGE(ENUM_in_operation_mode_real, message.value, source, dest);
-                break;
-            case 0x4008: // ENUM_in_fan_vent_mode
-                LOG_MESSAGE(ENUM_in_fan_vent_mode, message.value, source, dest);
-                // fan_vent_mode_to_fanmode();
-                break;
-            case 0x4211: // VAR_in_capacity_request unit = 'kW'
-            {
-                double temp = (double)message.value / (double)8.6;
-                LOG_MESSAGE(VAR_in_capacity_request, temp, source, dest);
-                break;
-            }
-            case 0x8001: // ENUM_out_operation_odu_mode
-                // Todo Map
-                LOG_MESSAGE(ENUM_out_operation_odu_mode, message.value, source, dest);
-                break;
-
-            case 0x8003: // ENUM_out_operation_heatcool
-                //['Undefined', 'Cool', 'Heat', 'CoolMain', 'HeatMain'];
-                // Todo Map
-                LOG_MESSAGE(ENUM_out_operation_heatcool, message.value, source, dest);
-                break;
-
-            case 0x801a: // ENUM_out_load_4way
-                LOG_MESSAGE(ENUM_out_load_4way, message.value, source, dest);
-                break;
-
-            case 0x8261: // VAR_OUT_SENSOR_PIPEIN3 unit = 'Celsius'
-            {
-                double temp = (double)message.value / (double)10;
-                LOG_MESSAGE(VAR_OUT_SENSOR_PIPEIN3, temp, source, dest);
-                break;
-            }
-            case 0x8262: // VAR_OUT_SENSOR_PIPEIN4 unit = 'Celsius'
-            {
-                double temp = (double)message.value / (double)10;
-                LOG_MESSAGE(VAR_OUT_SENSOR_PIPEIN4, temp, source, dest);
-                break;
-            }
-            case 0x8263: // VAR_OUT_SENSOR_PIPEIN5 unit = 'Celsius'
-            {
-                double temp = (double)message.value / (double)10;
-                LOG_MESSAGE(VAR_OUT_SENSOR_PIPEIN5, temp, source, dest);
-                break;
-            }
-            case 0x8264: // VAR_OUT_SENSOR_PIPEOUT1 unit = 'Celsius'
-            {
-                double temp = (double)message.value / (double)10;
-                LOG_MESSAGE(VAR_OUT_SENSOR_PIPEOUT1, temp, source, dest);
-                break;
-            }
-            case 0x8265: // VAR_OUT_SENSOR_PIPEOUT2 unit = 'Celsius'
-            {
-                double temp = (double)message.value / (double)10;
-                LOG_MESSAGE(VAR_OUT_SENSOR_PIPEOUT2, temp, source, dest);
-                break;
-            }
-            case 0x8266: // VAR_OUT_SENSOR_PIPEOUT3 unit = 'Celsius'
-            {
-                double temp = (double)message.value / (double)10;
-                LOG_MESSAGE(VAR_OUT_SENSOR_PIPEOUT3, temp, source, dest);
-                break;
-            }
-            case 0x8267: // VAR_OUT_SENSOR_PIPEOUT4 unit = 'Celsius'
-            {
-                double temp = (double)message.value / (double)10;
-                LOG_MESSAGE(VAR_OUT_SENSOR_PIPEOUT4, temp, source, dest);
-                break;
-            }
-            case 0x8268: // VAR_OUT_SENSOR_PIPEOUT5 unit = 'Celsius'
-            {
-                double temp = (double)message.value / (double)10;
-                LOG_MESSAGE(VAR_OUT_SENSOR_PIPEOUT5, temp, source, dest);
-                break;
-            }
-            case 0x8274: // VAR_out_control_order_cfreq_comp2
-                LOG_MESSAGE(VAR_out_control_order_cfreq_comp2, message.value, source, dest);
-                break;
-            case 0x8275: // VAR_out_control_target_cfreq_comp2
-                LOG_MESSAGE(VAR_out_control_target_cfreq_comp2, message.value, source, dest);
-                break;
-
-            case 0x82bc: // VAR_OUT_PROJECT_CODE
-                LOG_MESSAGE(VAR_OUT_PROJECT_CODE, message.value, source, dest);
-                break;
-
-            case 0x82e3: // VAR_OUT_PRODUCT_OPTION_CAPA
-                LOG_MESSAGE(VAR_OUT_PRODUCT_OPTION_CAPA, message.value, source, dest);
-                break;
-
-            case 0x8280: // VAR_out_sensor_top1 unit = 'Celsius'
-            {
-                double temp = (double)message.value / (double)10;
-                LOG_MESSAGE(VAR_out_sensor_top1, temp, source, dest);
-                break;
-            }
-            case 0x82db: // VAR_OUT_PHASE_CURRENT
-                LOG_MESSAGE(VAR_OUT_PHASE_CURRENT, message.value, source, dest);
-                break;
-
-            case 0x402:
-            case 0x409:
-            case 0x40a:
-            case 0x40b:
-            case 0x40c:
-            case 0x40d:
-            case 0x40e:
-            case 0x410:
-            case 0x411:
-            case 0x412:
-            case 0x413:
-            case 0x414:
-            case 0x415:
-            case 0x416:
-            case 0x601:
-            case 0x207:
-            case 0x41b:
-            case 0x60c:
-            case 0x24fb:
-            case 0x4015:
-            case 0x4016:
-            case 0x401b:
-            case 0x4023:
-            case 0x4024:
-            case 0x4027:
-            case 0x4028:
-            case 0x402d:
-            case 0x402e:
-            case 0x4035:
-            case 0x403e:
-            case 0x403f:
-            case 0x4043:
-            case 0x4045:
-            case 0x4046:
-            case 0x4047:
-            case 0x4048:
-            case 0x4059:
-            case 0x4074:
-            case 0x407d:
-            case 0x407e:
-            case 0x40ae:
-            case 0x40af:
-            case 0x40bc:
-            case 0x40bd:
-            case 0x40d5:
-            case 0x410a:
-            case 0x410b:
-            case 0x410c:
-            case 0x4111:
-            case 0x4112:
-            case 0x42df:
-            case 0x4604:
-            case 0x80af:
-            case 0x8204:
-            case 0x820a:
-            case 0x8217:
-            case 0x8218:
-            case 0x821a:
-            case 0x8223:
-            case 0x4212:
-            case 0x4222:
-            case 0x4229:
-            case 0x42e0:
-            case 0x8229:
-            case 0x822a:
-            case 0x822b:
-            case 0x822c:
-            case 0x8233:
-            case 0x8236:
-            case 0x8237:
-            case 0x8238:
-            case 0x8239:
-            case 0x823b:
-            case 0x823d:
-            case 0x42e3:
-            case 0x42e5:
-            case 0x440e:
-            case 0x440f:
-            case 0x4418:
-            case 0x441b:
-            case 0x441f:
-            case 0x4420:
-            case 0x4423:
-            case 0x4424:
-            case 0x8000:
-            case 0x8002:
-            case 0x800d:
-            case 0x8010:
-            case 0x8020:
-            case 0x8030:
-            case 0x8032:
-            case 0x8033:
-            case 0x8043:
-            case 0x8045:
-            case 0x8046:
-            case 0x8048:
-            case 0x8061:
-            case 0x8066:
-            case 0x8077:
-            case 0x807c:
-            case 0x807d:
-            case 0x807e:
-            case 0x8081:
-            case 0x808c:
-            case 0x808e:
-            case 0x808f:
-            case 0x809d:
-            case 0x8047:
-            case 0x8200:
-            case 0x8201:
-            case 0x8202:
-            case 0x822d:
-            case 0x8287:
-            case 0x82a1:
-            case 0x82b5:
-            case 0x82b6:
-            case 0x8411:
-            case 0x8413:
-            case 0x8414:
-            case 0x8608:
-            case 0x860c:
-            case 0x860d:
-            case 0x840a:
-            case 0x8410:
-            case 0x823e:
-            case 0x8247:
-            case 0x8249:
-            case 0x824b:
-            case 0x824c:
-            case 0x824f:
-            case 0x8254:
-            case 0x825f:
-            case 0x8260:
-            case 0x2400:
-            case 0x2401:
-            case 0x24fc:
-            {
-                // ESP_LOGW(TAG, "s:%s d:%s Todo %s %li", source.c_str(), dest.c_str(), long_to_hex((int)message.messageNumber).c_str(), message.value);
-                break; // Todo
-            }
-
-            case 0x8601: // STR_out_install_inverter_and_bootloader_info
-            case 0x608:  // STR_ad_dbcode_micom_main
-            case 0x603:  // STR_ad_option_cycle
-            case 0x602:  // STR_ad_option_install_2
-            case 0x600:  // STR_ad_option_basic
-            case 0x202:  // VAR_ad_error_code1
-            case 0x42d1: // VAR_IN_DUST_SENSOR_PM10_0_VALUE
-                if (debug_log_messages)
-                {
-                    ESP_LOGW(TAG, "s:%s d:%s VAR_IN_DUST_SENSOR_PM10_0_VALUE %s %li", source.c_str(), dest.c_str(), long_to_hex((int)message.messageNumber).c_str(), message.value);
-                }
-                break;   // Ingore cause not important
-            case 0x42d2: // VAR_IN_DUST_SENSOR_PM2_5_VALUE
-                if (debug_log_messages)
-                {
-                    ESP_LOGW(TAG, "s:%s d:%s VAR_IN_DUST_SENSOR_PM2_5_VALUE %s %li", source.c_str(), dest.c_str(), long_to_hex((int)message.messageNumber).c_str(), message.value);
-                }
-                break;   // Ingore cause not important
-            case 0x42d3: // VAR_IN_DUST_SENSOR_PM1_0_VALUE
-                if (debug_log_messages)
-                {
-                    ESP_LOGW(TAG, "s:%s d:%s VAR_IN_DUST_SENSOR_PM1_0_VALUE %s %li", source.c_str(), dest.c_str(), long_to_hex((int)message.messageNumber).c_str(), message.value);
-                }
-                break; // Ingore cause not important
-
-            case 0x23:
-            case 0x61d:
-            case 0x400a:
-            case 0x400f:
-            case 0x42e1:
-            case 0x42e2:
-            case 0x42e4:
-            case 0x22f9:
-            case 0x22fa:
-            case 0x22fb:
-            case 0x22fc:
-            case 0x22fd:
-            case 0x22fe:
-            case 0x22ff:
-            case 0x80a7:
-            case 0x80a8:
-            case 0x80a9:
-            case 0x80aa:
-            case 0x80ab:
-            case 0x80b2:
-            case 0x4285:
-            case 0x429d:
-            case 0x826a:
-            case 0x22f7:
-            case 0x82da:
-            case 0x82d9:
-            case 0x82ee:
-            case 0x82ef:
-            case 0x82e6:
-            case 0x82e5:
-            case 0x82dd:
-            case 0x4202:
-            case 0x82d4:
-            case 0x421c:
-            case 0x8031:
-            case 0x805e:
-            case 0x8243:
-            case 0x803f:
-            case 0x808d:
-            case 0x8248:
-            case 0x823f:
-            case 0x4204:
-            case 0x4006:
-            {
-                // ESP_LOGW(TAG, "s:%s d:%s NoMap %s %li", source.c_str(), dest.c_str(), long_to_hex((int)message.messageNumber).c_str(), message.value);
-                break; // message types which have no mapping in xml
-            }
-
-            default:
-                if (debug_log_undefined_messages)
-                {
-                    ESP_LOGW(TAG, "s:%s d:%s !! unknown %s", source.c_str(), dest.c_str(), message.to_string().c_str());
-                }
-                break;
-            }
+            nasa_poll_scheduler.update(target, target->get_miliseconds());
         }
 
-        void NasaProtocol::protocol_update(MessageTarget *target)
+        void NasaProtocol::add_poll(DeviceAddress address, uint16_t message_number, uint32_t interval, uint8_t priority)
         {
-            // Unused for NASA protocol
+            nasa_poll_scheduler.add(address, message_number, interval, priority);
         }
 
     } // namespace samsung_ac
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <vector>
 #include "protocol.h"
 
@@ -89,6 +90,9 @@ namespace esphome
             VAR_in_temp_eva_in_f = 0x4205,
             VAR_in_temp_eva_out_f = 0x4206,
             VAR_out_error_code = 0x8235,
+            STR_ad_option_basic = 0x0600,
+            STR_ad_dbcode_micom_main = 0x0608,
+            STR_out_install_inverter_and_bootloader_info = 0x8601,
         };
 
         struct Address
@@ -99,9 +103,12 @@ namespace esphome
             uint8_t size = 3;
 
             static Address parse(const std::string &str);
+            static Address unpack(DeviceAddress packed);
             static Address get_my_address();
 
-            void decode(std::vector<uint8_t> &data, unsigned int index);
+            DeviceAddress packed() const;
+
+            void decode(ByteSpan data, unsigned int index);
             void encode(std::vector<uint8_t> &data);
             std::string to_string();
         };
@@ -117,27 +124,29 @@ namespace esphome
 
             uint8_t size = 3;
 
-            void decode(std::vector<uint8_t> &data, unsigned int index);
+            void decode(ByteSpan data, unsigned int index);
             void encode(std::vector<uint8_t> &data);
             std::string to_string();
         };
 
-        struct Buffer
+        // Structure payload of a MessageSet. It points into the frame it was decoded from (or into
+        // the buffer it is encoded from) and is only valid as long as that memory is.
+        struct StructureView
         {
-            uint8_t size;
-            uint8_t data[255];
+            const uint8_t *data;
+            uint16_t size;
         };
 
         struct MessageSet
         {
             MessageNumber messageNumber = MessageNumber::Undefiend;
             MessageSetType type = Enum;
+            uint16_t size = 2;
             union
             {
                 long value;
-                Buffer structure;
+                StructureView structure;
             };
-            uint16_t size = 2;
 
             MessageSet(MessageNumber messageNumber)
             {
@@ -147,12 +156,48 @@ namespace esphome
                 // this->_msgIndex = (ushort) ((uint) messageNumber & 511U);
             }
 
-            static MessageSet decode(std::vector<uint8_t> &data, unsigned int index, int capacity);
+            // data ends with the last message byte (crc and end byte are excluded). If the message
+            // does not fit into data the returned set has a size of 0. A structure message has no
+            // length field, it runs until the end of data.
+            static MessageSet decode(ByteSpan data, unsigned int index);
 
             void encode(std::vector<uint8_t> &data);
             std::string to_string();
+
+            // Structure payload as text. Stops at the first zero byte, other unprintable bytes are
+            // replaced by a '.'. Empty if this is not a structure message.
+            std::string structure_text() const;
+            std::string structure_hex() const;
+
+            // Typed accessors for the known structure messages, empty if this is another message.
+            // Option code of the unit (STR_ad_option_basic), shown as hex like on the installer menu.
+            std::string get_option_basic() const;
+            // Main micom DB code (STR_ad_dbcode_micom_main).
+            std::string get_dbcode_micom_main() const;
+            // Inverter and bootloader firmware info of the outdoor unit (STR_out_install_inverter_and_bootloader_info).
+            std::string get_inverter_and_bootloader_info() const;
+        };
+
+        typedef void (*MessageHandler)(DeviceState &state, long raw, double value);
+
+        // Describes a known NASA message. The type of a message is part of its number (see
+        // MessageSet). value = raw (sign extended if is_signed) / divisor. The handler stores the
+        // value in the state of the packet.
+        struct MessageInfo
+        {
+            uint16_t number;
+            const char *name;
+            float divisor;
+            bool is_signed;
+            MessageHandler handler;
+
+            MessageSetType type() const { return (MessageSetType)((number & 1536) >> 9); }
+            double to_value(long raw) const;
         };
 
+        // Looks up the registry of known messages, nullptr if the number is unknown.
+        const MessageInfo *find_message_info(MessageNumber number);
+
         struct Packet
         {
             Address sa;
@@ -163,21 +208,187 @@ namespace esphome
             static Packet create(Address da, DataType dataType, MessageNumber messageNumber, int value);
             static Packet createa_partial(Address da, DataType dataType);
 
-            DecodeResult decode(std::vector<uint8_t> &data);
+            DecodeResult decode(ByteSpan data, bool verify_crc = true);
             std::vector<uint8_t> encode();
             std::string to_string();
         };
 
-        DecodeResult try_decode_nasa_packet(std::vector<uint8_t> data);
+        // NASA packets use CRC-16/XMODEM (poly 0x1021, msb first, init 0). The lookup tables are
+        // generated at compile time. ESP8266 keeps a single 512 byte table, the other targets get
+        // three more tables to process 4 bytes per step (slice-by-4).
+#ifdef USE_ESP8266
+        static constexpr size_t CRC16_SLICES = 1;
+#else
+        static constexpr size_t CRC16_SLICES = 4;
+#endif
+
+        typedef std::array<std::array<uint16_t, 256>, CRC16_SLICES> Crc16Table;
+
+        constexpr Crc16Table make_crc16_table()
+        {
+            Crc16Table table{};
+            for (uint16_t i = 0; i < 256; i++)
+            {
+                uint16_t crc = i << 8;
+                for (uint8_t bit = 0; bit < 8; bit++)
+                    crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+                table[0][i] = crc;
+            }
+            // table[n][i] is the crc of byte i followed by n zero bytes
+            for (size_t n = 1; n < CRC16_SLICES; n++)
+            {
+                for (uint16_t i = 0; i < 256; i++)
+                    table[n][i] = (table[n - 1][i] << 8) ^ table[0][table[n - 1][i] >> 8];
+            }
+            return table;
+        }
+
+        inline constexpr Crc16Table crc16_table = make_crc16_table();
+
+        static_assert(crc16_table[0][1] == 0x1021, "crc16 table is broken");
+
+        inline uint16_t crc16_update(uint16_t crc, uint8_t value)
+        {
+            return (crc << 8) ^ crc16_table[0][(crc >> 8) ^ value];
+        }
+
+        uint16_t crc16(ByteSpan data, int startIndex, int length);
+
+        DecodeResult try_decode_nasa_packet(ByteSpan data, bool verify_crc = true);
         void process_nasa_packet(MessageTarget *target);
 
+        struct NasaTransactionStats
+        {
+            uint32_t completed = 0;
+            uint32_t nacked = 0;
+            uint32_t retries = 0;
+            uint32_t expired = 0;
+            uint32_t last_rtt = 0;
+            uint32_t max_rtt = 0;
+        };
+
+        // Sent requests which wait for their Ack, Nack or Response. A reply is matched by the packet
+        // number and the address the request was sent to. Requests without reply are sent again with
+        // an increased retryCount (by a timer of the target) and dropped after MAX_RETRIES. The table
+        // has a fixed size, when it is full the oldest request is dropped.
+        class NasaTransactionTable
+        {
+        public:
+            static constexpr uint8_t CAPACITY = 8;
+            static constexpr uint32_t TIMEOUT = 1500;
+            static constexpr uint8_t MAX_RETRIES = 2;
+
+            void add(MessageTarget *target, const Packet &packet);
+            // Returns false when the reply does not belong to one of our requests.
+            bool complete(DeviceAddress source, uint8_t packet_number, bool success, uint32_t now);
+            void clear();
+
+            size_t size() const;
+            const NasaTransactionStats &stats() const { return stats_; }
+
+        protected:
+            struct Transaction
+            {
+                bool used = false;
+                DeviceAddress dest;
+                uint32_t first_sent = 0;
+                uint32_t last_sent = 0;
+                Packet packet;
+                WheelTimer timer;
+            };
+
+            // Resends or expires a request which timed out.
+            void timeout(MessageTarget *target, Transaction &transaction);
+
+            Transaction transactions_[CAPACITY];
+            NasaTransactionStats stats_;
+        };
+
+        extern NasaTransactionTable nasa_transactions;
+
+        struct NasaSequenceStats
+        {
+            uint32_t received = 0;
+            uint32_t duplicates = 0;
+            uint32_t missing = 0;
+        };
+
+        // Packet numbers of the sources on the bus. Every source counts its packets up, a packet with
+        // the last number of its source and a retry count is a retransmission and skipped, a jump of
+        // the number means packets were lost. The same number without retry count is a new packet,
+        // the 8 bit number wrapped around (e.g. the source restarted or we missed 255 packets).
+        // Replies carry the number of the request, so only packets which start a transaction are
+        // tracked.
+        class NasaSequenceTracker
+        {
+        public:
+            static constexpr uint8_t CAPACITY = 16;
+            // larger jumps are seen as a restart of the source and not counted as missing
+            static constexpr uint8_t MAX_GAP = 32;
+
+            // Returns false when the packet was already processed.
+            bool track(DeviceAddress source, uint8_t packet_number, uint8_t retry_count, uint32_t now);
+            void clear();
+
+            const NasaSequenceStats &stats() const { return stats_; }
+
+        protected:
+            struct Source
+            {
+                bool used = false;
+                DeviceAddress address;
+                uint8_t packet_number = 0;
+                uint32_t last_seen = 0;
+            };
+
+            Source sources_[CAPACITY];
+            NasaSequenceStats stats_;
+        };
+
+        extern NasaSequenceTracker nasa_sequence_tracker;
+
+        // Sends Read requests for messages which are not notified often enough by the units. Due
+        // messages of the same device are packed into one packet, at most one packet is sent per
+        // update. The responses are processed like notifications.
+        class NasaPollScheduler
+        {
+        public:
+            // limits of the capacity byte and of the packet size the decoder accepts
+            static constexpr uint8_t MAX_MESSAGES = 255;
+            static constexpr uint16_t MAX_PACKET_SIZE = 1500;
+
+            void add(DeviceAddress address, uint16_t message_number, uint32_t interval, uint8_t priority);
+            // Returns true when a Read request was sent.
+            bool update(MessageTarget *target, uint32_t now);
+            void clear() { polls_.clear(); }
+
+        protected:
+            struct Poll
+            {
+                DeviceAddress address;
+                uint16_t message_number;
+                uint8_t priority;
+                bool polled = false;
+                uint32_t interval;
+                uint32_t last_poll = 0;
+
+                bool due(uint32_t now) const { return !polled || now - last_poll >= interval; }
+            };
+
+            // sorted by priority (highest first), so the due messages are packed in that order
+            std::vector<Poll> polls_;
+        };
+
+        extern NasaPollScheduler nasa_poll_scheduler;
+
         class NasaProtocol : public Protocol
         {
         public:
             NasaProtocol() = default;
 
-            void publish_request(MessageTarget *target, const std::string &address, ProtocolRequest &request) override;
+            void publish_request(MessageTarget *target, DeviceAddress address, ProtocolRequest &request) override;
             void protocol_update(MessageTarget *target) override;
+            void add_poll(DeviceAddress address, uint16_t message_number, uint32_t interval, uint8_t priority) override;
         };
 
     } // namespace samsung_ac
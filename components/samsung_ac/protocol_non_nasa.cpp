@@ -1,13 +1,13 @@
 #include <queue>
-#include <map>
 #include <cmath>
+#include <algorithm>
 #include <string>
 #include "esphome/core/log.h"
 #include "esphome/core/hal.h"
 #include "util.h"
 #include "protocol_non_nasa.h"
 
-std::map<std::string, esphome::samsung_ac::NonNasaCommand20> last_command20s_;
+esphome::samsung_ac::NonNasaStateTable last_command20s_;
 
 esphome::samsung_ac::NonNasaDataPacket nonpacket_;
 
@@ -15,11 +15,162 @@ namespace esphome
 {
     namespace samsung_ac
     {
-        std::list<NonNasaRequestQueueItem> nonnasa_requests;
+        NonNasaRequestQueue nonnasa_requests;
+        NonNasaTiming nonnasa_timing;
+        NonNasaDispatcher nonnasa_dispatcher;
         bool controller_registered = false;
         bool indoor_unit_awake = true;
+        WheelTimer keepalive_timer;
 
-        uint8_t build_checksum(std::vector<uint8_t> &data)
+        void send_register_controller(MessageTarget *target);
+
+        const NonNasaCommand20 *NonNasaStateTable::find(uint8_t address) const
+        {
+            const uint8_t index = index_[address];
+            return index == 0 ? nullptr : &states_[index - 1];
+        }
+
+        void NonNasaStateTable::update(uint8_t address, const NonNasaCommand20 &state)
+        {
+            uint8_t &index = index_[address];
+            if (index == 0)
+            {
+                if (size_ >= CAPACITY)
+                {
+                    ESP_LOGW(TAG, "too many indoor units, ignoring state of %02x", address);
+                    return;
+                }
+                index = ++size_;
+            }
+            states_[index - 1] = state;
+        }
+
+        void NonNasaStateTable::clear()
+        {
+            std::fill(std::begin(index_), std::end(index_), 0);
+            size_ = 0;
+        }
+
+        static uint32_t average(uint32_t average, uint32_t sample)
+        {
+            return average == 0 ? sample : (average * 3 + sample) / 4;
+        }
+
+        // A longer gap between two polls is a sleeping unit and not its poll interval
+        static constexpr uint32_t MAX_POLL_INTERVAL = 10000;
+
+        void NonNasaTiming::poll_received(uint32_t now)
+        {
+            if (polled_ && now - last_poll_ <= MAX_POLL_INTERVAL)
+                poll_interval_ = average(poll_interval_, now - last_poll_);
+            if (waking_)
+            {
+                wake_latency_ = average(wake_latency_, now - wake_sent_);
+                waking_ = false;
+            }
+            last_poll_ = now;
+            polled_ = true;
+        }
+
+        void NonNasaTiming::ack_received(uint32_t latency)
+        {
+            ack_latency_ = average(ack_latency_, latency);
+        }
+
+        void NonNasaTiming::wake_sent(uint32_t now)
+        {
+            wake_sent_ = now;
+            waking_ = true;
+        }
+
+        void NonNasaTiming::clear()
+        {
+            *this = NonNasaTiming();
+        }
+
+        bool NonNasaTiming::likely_asleep(uint32_t now) const
+        {
+            // without measurements the unit gets the usual time to poll first
+            if (!polled_ || poll_interval_ == 0)
+                return false;
+            return now - last_poll_ > std::max<uint32_t>(poll_interval_ * 3, 3000);
+        }
+
+        uint32_t NonNasaTiming::wake_delay() const
+        {
+            if (poll_interval_ == 0)
+                return DEFAULT_WAKE_DELAY;
+            // give an awake unit one and a half poll intervals before waking it
+            return std::min<uint32_t>(std::max<uint32_t>(poll_interval_ * 3 / 2, 500), 3000);
+        }
+
+        uint32_t NonNasaTiming::resend_timeout() const
+        {
+            if (ack_latency_ == 0)
+                return DEFAULT_RESEND_TIMEOUT;
+            return std::min<uint32_t>(std::max<uint32_t>(ack_latency_ * 3, 1000), DEFAULT_RESEND_TIMEOUT);
+        }
+
+        uint32_t NonNasaTiming::expire_timeout() const
+        {
+            const uint32_t timeout = wake_delay() + wake_latency_ + resend_timeout() * (MAX_RESENDS + 1);
+            return std::min<uint32_t>(std::max<uint32_t>(timeout, 5000), MAX_EXPIRE_TIMEOUT);
+        }
+
+        uint32_t NonNasaTiming::request_time() const
+        {
+            return std::max(ack_latency_, FRAME_TIME * 2);
+        }
+
+        NonNasaRequestQueueItem *NonNasaRequestQueue::find(uint8_t dst)
+        {
+            for (auto &item : items_)
+            {
+                if (item.used && item.request.dst == dst)
+                    return &item;
+            }
+            return nullptr;
+        }
+
+        NonNasaRequestQueueItem *NonNasaRequestQueue::allocate(uint8_t dst)
+        {
+            for (auto &item : items_)
+            {
+                if (!item.used)
+                {
+                    item.used = true;
+                    item.request.dst = dst;
+                    return &item;
+                }
+            }
+            return nullptr;
+        }
+
+        void NonNasaRequestQueue::remove(NonNasaRequestQueueItem &item)
+        {
+            item.expire_timer.cancel();
+            item.retry_timer.cancel();
+            item.used = false;
+        }
+
+        void NonNasaRequestQueue::clear()
+        {
+            for (auto &item : items_)
+                remove(item);
+        }
+
+        size_t NonNasaRequestQueue::size() const
+        {
+            size_t count = 0;
+            for (const auto &item : items_)
+            {
+                if (item.used)
+                    count++;
+            }
+            return count;
+        }
+
+        uint8_t build_checksum(ByteSpan data)
         {
             uint8_t sum = data[1];
             for (uint8_t i = 2; i < 12; i++)
@@ -106,8 +257,8 @@ namespace esphome
         {
             std::string str;
             str += "{";
-            str += "src:" + src + ";";
-            str += "dst:" + dst + ";";
+            str += "src:" + long_to_hex(src) + ";";
+            str += "dst:" + long_to_hex(dst) + ";";
             str += "cmd:" + long_to_hex((uint8_t)cmd) + ";";
             switch (cmd)
             {
@@ -157,27 +308,27 @@ namespace esphome
             return str;
         }
 
-        DecodeResult NonNasaDataPacket::decode(std::vector<uint8_t> &data)
+        DecodeResult NonNasaDataPacket::decode(ByteSpan data)
         {
+            if (data.size != 14)
+                return DecodeResult::UnexpectedSize;
+
             if (data[0] != 0x32)
                 return DecodeResult::InvalidStartByte;
 
-            if (data.size() != 14)
-                return DecodeResult::UnexpectedSize;
-
-            if (data[data.size() - 1] != 0x34)
+            if (data[data.size - 1] != 0x34)
                 return DecodeResult::InvalidEndByte;
 
             auto crc_expected = build_checksum(data);
-            auto crc_actual = data[data.size() - 2];
+            auto crc_actual = data[data.size - 2];
             if (crc_actual != build_checksum(data))
             {
                 ESP_LOGW(TAG, "NonNASA: invalid crc - got %d but should be %d: %s", crc_actual, crc_expected, bytes_to_hex(data).c_str());
                 return DecodeResult::CrcError;
             }
 
-            src = long_to_hex(data[1]);
-            dst = long_to_hex(data[2]);
+            src = data[1];
+            dst = data[2];
 
             cmd = (NonNasaCommand)data[3];
             switch (cmd)
@@ -258,9 +409,8 @@ namespace esphome
             }
             default:
             {
-                commandRaw.length = data.size() - 4 - 1;
-                auto begin = data.begin() + 4;
-                std::copy(begin, begin + commandRaw.length, commandRaw.data);
+                commandRaw.length = data.size - 4 - 1;
+                std::copy(data.data + 4, data.data + 4 + commandRaw.length, commandRaw.data);
                 return DecodeResult::Ok;
             }
             }
@@ -312,20 +462,20 @@ namespace esphome
         std::vector<uint8_t> NonNasaRequest::encode()
         {
             std::vector<uint8_t> data{
-                0x32,                     // 00 start
-                0xD0,                     // 01 src
-                (uint8_t)hex_to_int(dst), // 02 dst
-                0xB0,                     // 03 cmd
-                0x1F,                     // 04 ?
-                0x04,                     // 05 ?
-                0,                        // 06 temp + fanmode
-                0,                        // 07 operation mode
-                0,                        // 08 power + individual mode
-                0,                        // 09
-                0,                        // 10
-                0,                        // 11
-                0,                        // 12 crc
-                0x34                      // 13 end
+                0x32,                // 00 start
+                NON_NASA_CONTROLLER, // 01 src
+                dst,                 // 02 dst
+                0xB0,                // 03 cmd
+                0x1F,                // 04 ?
+                0x04,                // 05 ?
+                0,                   // 06 temp + fanmode
+                0,                   // 07 operation mode
+                0,                   // 08 power + individual mode
+                0,                   // 09
+                0,                   // 10
+                0,                   // 11
+                0,                   // 12 crc
+                0x34                 // 13 end
             };
 
             // individual seems to deactivate the locale remotes with message "CENTRAL".
@@ -346,17 +496,20 @@ namespace esphome
             return data;
         }
 
-        NonNasaRequest NonNasaRequest::create(std::string dst_address)
+        NonNasaRequest NonNasaRequest::create(uint8_t dst_address)
         {
             NonNasaRequest request;
             request.dst = dst_address;
 
-            auto last_command20_ = last_command20s_[dst_address];
-            request.room_temp = last_command20_.room_temp;
-            request.power = last_command20_.power;
-            request.target_temp = last_command20_.target_temp;
-            request.fanspeed = last_command20_.fanspeed;
-            request.mode = last_command20_.mode;
+            const NonNasaCommand20 *last_command20_ = last_command20s_.find(dst_address);
+            if (last_command20_ != nullptr)
+            {
+                request.room_temp = last_command20_->room_temp;
+                request.power = last_command20_->power;
+                request.target_temp = last_command20_->target_temp;
+                request.fanspeed = last_command20_->fanspeed;
+                request.mode = last_command20_->mode;
+            }
 
             return request;
         }
@@ -396,9 +549,23 @@ namespace esphome
             }
         }
 
-        void NonNasaProtocol::publish_request(MessageTarget *target, const std::string &address, ProtocolRequest &request)
+        void NonNasaProtocol::publish_request(MessageTarget *target, DeviceAddress address, ProtocolRequest &request)
         {
-            auto req = NonNasaRequest::create(address);
+            const uint8_t dst = address.address();
+
+            // A pending request for the unit is updated, so several changes (from different
+            // wall panels or HA) end up in one control message and none of them get lost.
+            NonNasaRequestQueueItem *item = nonnasa_requests.find(dst);
+            NonNasaRequest req = item != nullptr ? item->request : NonNasaRequest::create(dst);
+            if (item == nullptr)
+            {
+                item = nonnasa_requests.allocate(dst);
+                if (item == nullptr)
+                {
+                    ESP_LOGW(TAG, "request queue is full, dropping request for %s", address.to_string().c_str());
+                    return;
+                }
+            }
 
             if (request.mode)
             {
@@ -425,20 +592,48 @@ namespace esphome
                 ESP_LOGW(TAG, "change swingmode is currently not implemented");
             }
 
-            // Add to the queue with the current time
-            NonNasaRequestQueueItem reqItem = NonNasaRequestQueueItem();
-            reqItem.request = req;
-            reqItem.time = millis();
-            reqItem.time_sent = 0;
-            reqItem.retry_count = 0;
-            reqItem.resend_count = 0;
-
-            // Safety check the length of the queue (in case something is spamming control
-            // requests we don't want the queue to get too large).
-            if (nonnasa_requests.size() < 10)
+            if (!request.custom_messages.empty())
             {
-                nonnasa_requests.push_back(reqItem);
+                ESP_LOGW(TAG, "custom messages are only supported by NASA devices");
             }
+
+            // A user command replaces a request which is waiting for its ack or resend, it is sent
+            // on the next request_control message with the current time.
+            item->request = req;
+            item->data = req.encode();
+            item->time = target->get_miliseconds();
+            item->sent = false;
+            item->retry_count = 0;
+            item->resend_count = 0;
+
+            // If the message is in the queue for too long (at most 15s), assume failure and remove
+            // it from the queue (the AC or UART connection is likely offline).
+            item->expire_timer.callback = [item]()
+            {
+                nonnasa_requests.remove(*item);
+            };
+            target->get_timers().schedule(item->expire_timer, item->time + nonnasa_timing.expire_timeout());
+
+            // If the message is still unsent after the outdoor unit should have polled us, it likely
+            // means the indoor and/or outdoor unit has gone to sleep due to inactivity. Send a
+            // registration request to wake the unit up. When the unit already stopped polling it
+            // is woken up right away.
+            item->retry_timer.callback = [item, target]()
+            {
+                if (!item->sent && item->resend_count == 0 && item->retry_count == 0)
+                {
+                    // Both the outdoor and the indoor unit must be awake before we can send a command
+                    indoor_unit_awake = false;
+                    item->retry_count++;
+                    ESP_LOGD(TAG, "Device is likely sleeping, waking...");
+                    nonnasa_timing.wake_sent(target->get_miliseconds());
+                    send_register_controller(target);
+                }
+            };
+            const uint32_t wake_delay = nonnasa_timing.likely_asleep(item->time) ? 0 : nonnasa_timing.wake_delay();
+            target->get_timers().schedule(item->retry_timer, item->time + wake_delay);
+
+            nonnasa_dispatcher.request_queued(target);
         }
 
         Mode nonnasa_mode_to_mode(NonNasaMode value)
@@ -488,23 +683,95 @@ namespace esphome
             }
         }
 
-        DecodeResult try_decode_non_nasa_packet(std::vector<uint8_t> data)
+        DecodeResult try_decode_non_nasa_packet(ByteSpan data)
         {
             return nonpacket_.decode(data);
         }
 
-        void send_requests(MessageTarget *target)
+        void send_request(MessageTarget *target, NonNasaRequestQueueItem &item, uint32_t now)
         {
-            const uint32_t now = millis();
-            for (auto &item : nonnasa_requests)
+            item.sent = true;
+            item.time_sent = now;
+            target->publish_data(item.data, TxPriority::Control);
+
+            // If the message wasn't acknowledged in time (at most 4.5s), assume it failed and queue
+            // it for resend on the next request_control message. Resend at most 3 times.
+            NonNasaRequestQueueItem *queued = &item;
+            queued->retry_timer.callback = [queued]()
             {
-                if (item.time_sent == 0)
+                if (queued->sent && queued->resend_count < NonNasaTiming::MAX_RESENDS)
                 {
-                    item.time_sent = now;
-                    auto data = item.request.encode();
-                    target->publish_data(data);
+                    queued->sent = false;
+                    queued->resend_count++;
                 }
+            };
+            target->get_timers().schedule(queued->retry_timer, now + nonnasa_timing.resend_timeout());
+        }
+
+        // Returns the next unsent request, new user commands go out before resends.
+        NonNasaRequestQueueItem *next_request()
+        {
+            NonNasaRequestQueueItem *resend = nullptr;
+            for (auto &item : nonnasa_requests)
+            {
+                if (!item.used || item.sent)
+                    continue;
+                if (item.resend_count == 0)
+                    return &item;
+                if (resend == nullptr)
+                    resend = &item;
+            }
+            return resend;
+        }
+
+        void NonNasaDispatcher::start(MessageTarget *target, uint32_t now)
+        {
+            // the window ends when the next poll is on the bus
+            const uint32_t interval = nonnasa_timing.poll_interval() > 0 ? nonnasa_timing.poll_interval() : NonNasaTiming::DEFAULT_POLL_INTERVAL;
+            window_end_ = now + interval - NonNasaTiming::FRAME_TIME;
+            window_open_ = true;
+            timer_.callback = [this, target]()
+            {
+                dispatch(target);
+            };
+            dispatch(target);
+        }
+
+        void NonNasaDispatcher::request_queued(MessageTarget *target)
+        {
+            if (!window_open_ || timer_.scheduled())
+                return;
+
+            // its ack has to be received before the window ends
+            if ((int32_t)(window_end_ - (target->get_miliseconds() + nonnasa_timing.request_time())) < 0)
+            {
+                window_open_ = false;
+                return;
             }
+            dispatch(target);
+        }
+
+        void NonNasaDispatcher::dispatch(MessageTarget *target)
+        {
+            // We know the outdoor unit is awake due to the request_control message, so we only
+            // need to check that the indoor unit is awake.
+            if (!indoor_unit_awake)
+                return;
+
+            NonNasaRequestQueueItem *item = next_request();
+            if (item == nullptr)
+                return;
+
+            const uint32_t now = target->get_miliseconds();
+            send_request(target, *item, now);
+
+            // the next request (also one which is queued in the meantime) goes out once this one
+            // was acknowledged, as long as its ack is received before the window ends
+            const uint32_t next = now + nonnasa_timing.request_time();
+            if ((int32_t)(window_end_ - (next + nonnasa_timing.request_time())) >= 0)
+                target->get_timers().schedule(timer_, next);
+            else
+                window_open_ = false;
         }
 
         void send_register_controller(MessageTarget *target)
@@ -515,25 +782,24 @@ namespace esphome
             // outdoor unit to poll us with a request_control message approximately every second,
             // which we can reply to with a control message if required.
             std::vector<uint8_t> data{
-                0x32, // 00 start
-                0xD0, // 01 src
-                0xc8, // 02 dst
-                0xD1, // 03 cmd (register_device)
-                0xD2, // 04 device_type (controller)
-                0,    // 05
-                0,    // 06
-                0,    // 07
-                0,    // 08
-                0,    // 09
-                0,    // 10
-                0,    // 11
-                0,    // 12 crc
-                0x34  // 13 end
+                0x32,                // 00 start
+                NON_NASA_CONTROLLER, // 01 src
+                NON_NASA_OUTDOOR,    // 02 dst
+                0xD1,                // 03 cmd (register_device)
+                0xD2,                // 04 device_type (controller)
+                0,                   // 05
+                0,                   // 06
+                0,                   // 07
+                0,                   // 08
+                0,                   // 09
+                0,                   // 10
+                0,                   // 11
+                0,                   // 12 crc
+                0x34                 // 13 end
             };
             data[12] = build_checksum(data);
 
-            // Send now
-            target->publish_data(data);
+            target->publish_data(data, TxPriority::Keepalive);
         }
 
         void process_non_nasa_packet(MessageTarget *target)
@@ -543,10 +809,11 @@ namespace esphome
                 ESP_LOGW(TAG, "MSG: %s", nonpacket_.to_string().c_str());
             }
 
-            target->register_address(nonpacket_.src);
+            const DeviceAddress source = DeviceAddress::non_nasa(nonpacket_.src);
+            target->register_address(source);
 
             // Check if we have a message from the indoor unit. If so, we can assume it is awake.
-            if (!indoor_unit_awake && get_address_type(nonpacket_.src) == AddressType::Indoor)
+            if (!indoor_unit_awake && get_address_type(source) == AddressType::Indoor)
             {
                 indoor_unit_awake = true;
             }
@@ -557,48 +824,45 @@ namespace esphome
                 // packet, so as a backup approach check if the state of the device matches that of the
                 // sent control packet. This also serves as a backup approach if for some reason a device
                 // doesn't send control_acknowledgement messages at all.
-                nonnasa_requests.remove_if([&](const NonNasaRequestQueueItem &item)
-                                           { return item.time_sent > 0 &&
-                                                    nonpacket_.src == item.request.dst &&
-                                                    item.request.target_temp == nonpacket_.command20.target_temp &&
-                                                    item.request.fanspeed == nonpacket_.command20.fanspeed &&
-                                                    item.request.mode == nonpacket_.command20.mode &&
-                                                    item.request.power == nonpacket_.command20.power; });
+                NonNasaRequestQueueItem *item = nonnasa_requests.find(nonpacket_.src);
+                if (item != nullptr && item->sent &&
+                    item->request.target_temp == nonpacket_.command20.target_temp &&
+                    item->request.fanspeed == nonpacket_.command20.fanspeed &&
+                    item->request.mode == nonpacket_.command20.mode &&
+                    item->request.power == nonpacket_.command20.power)
+                {
+                    nonnasa_requests.remove(*item);
+                }
 
                 // If a state update comes through after a control message has been sent, but before it
                 // has been acknowledged, it should be ignored. This prevents the UI status bouncing
                 // between states after a command has been issued.
-                bool pending_control_message = false;
-                for (auto& item : nonnasa_requests)
-                {
-                   if (item.time_sent > 0 && nonpacket_.src == item.request.dst)
-                   {
-                      pending_control_message = true;
-                      break;
-                   }
-                }
+                bool pending_control_message = item != nullptr && item->used && item->sent;
 
                 if (!pending_control_message)
                 {
-                   last_command20s_[nonpacket_.src] = nonpacket_.command20;
-                   target->set_target_temperature(nonpacket_.src, nonpacket_.command20.target_temp);
+                   last_command20s_.update(nonpacket_.src, nonpacket_.command20);
+
+                   DeviceState state;
+                   state.target_temperature = nonpacket_.command20.target_temp;
                    // TODO
-                   target->set_water_outlet_target(nonpacket_.src, false);
+                   state.water_outlet_target = 0;
                    // TODO
-                   target->set_target_water_temperature(nonpacket_.src, false);
-                   target->set_room_temperature(nonpacket_.src, nonpacket_.command20.room_temp);
-                   target->set_power(nonpacket_.src, nonpacket_.command20.power);
+                   state.target_water_temperature = 0;
+                   state.room_temperature = nonpacket_.command20.room_temp;
+                   state.power = nonpacket_.command20.power;
                    // TODO
-                   target->set_water_heater_power(nonpacket_.src, false);
-                   target->set_mode(nonpacket_.src, nonnasa_mode_to_mode(nonpacket_.command20.mode));
+                   state.water_heater_power = false;
+                   state.mode = nonnasa_mode_to_mode(nonpacket_.command20.mode);
                    // TODO
-				   target->set_water_heater_mode(nonpacket_.src, nonnasa_water_heater_mode_to_mode(-0));
-                   target->set_fanmode(nonpacket_.src, nonnasa_fanspeed_to_fanmode(nonpacket_.command20.fanspeed));
+                   state.water_heater_mode = nonnasa_water_heater_mode_to_mode(-0);
+                   state.fanmode = nonnasa_fanspeed_to_fanmode(nonpacket_.command20.fanspeed);
                    // TODO
-                   target->set_altmode(nonpacket_.src, 0);
+                   state.altmode = 0;
                    // TODO
-                   target->set_swing_horizontal(nonpacket_.src, false);
-                   target->set_swing_vertical(nonpacket_.src, false);
+                   state.swing_horizontal = false;
+                   state.swing_vertical = false;
+                   target->set_state(source, state);
                 }
             }
             else if (nonpacket_.cmd == NonNasaCommand::CmdC6)
@@ -606,44 +870,53 @@ namespace esphome
                 // We have received a request_control message. This is a message outdoor units will
                 // send to a registered controller, allowing us to reply with any control commands.
                 // Control commands should be sent immediately (per SNET Pro behaviour).
-                if (nonpacket_.src == "c8" && nonpacket_.dst == "d0" && nonpacket_.commandC6.control_status == true)
+                if (nonpacket_.src == NON_NASA_OUTDOOR && nonpacket_.dst == NON_NASA_CONTROLLER && nonpacket_.commandC6.control_status == true)
                 {
+                    nonnasa_timing.poll_received(target->get_miliseconds());
                     if (controller_registered == false)
                     {
                         ESP_LOGD(TAG, "Controller registered");
                         controller_registered = true;
                     }
-                    if (indoor_unit_awake)
-                    {
-                        // We know the outdoor unit is awake due to this request_control message, so we only
-                        // need to check that the indoor unit is awake.
-                        send_requests(target);
-                    }
+                    nonnasa_dispatcher.start(target, target->get_miliseconds());
                 }
             }
-            else if (nonpacket_.cmd == NonNasaCommand::Cmd54 && nonpacket_.dst == "d0")
+            else if (nonpacket_.cmd == NonNasaCommand::Cmd54 && nonpacket_.dst == NON_NASA_CONTROLLER)
             {
                 // We have received a control_acknowledgement message. This message will come from an
                 // indoor unit in reply to a control message from us, allowing us to confirm the control
                 // message was successfully sent. The data portion contains the same data we sent (however
                 // we can just assume it's for any sent packet, rather than comparing).
-                nonnasa_requests.remove_if([&](const NonNasaRequestQueueItem &item)
-                                           { return item.time_sent > 0 && nonpacket_.src == item.request.dst; });
+                NonNasaRequestQueueItem *item = nonnasa_requests.find(nonpacket_.src);
+                if (item != nullptr && item->sent)
+                {
+                    nonnasa_timing.ack_received(target->get_miliseconds() - item->time_sent);
+                    nonnasa_requests.remove(*item);
+                }
             }
-            else if (nonpacket_.src == "c8" && nonpacket_.dst == "ad" && (nonpacket_.commandRaw.data[0] & 1) == 1)
+            else if (nonpacket_.src == NON_NASA_OUTDOOR && nonpacket_.dst == NON_NASA_BROADCAST && (nonpacket_.commandRaw.data[0] & 1) == 1)
             {
                 // We have received a broadcast registration request. It isn't necessary to register
-                // more than once, however we can use this as a keepalive method. A 30ms delay is added
-                // to allow other controllers to register. This mimics SNET Pro behaviour.
+                // more than once, however we can use this as a keepalive method. The reply is sent 30ms
+                // later to allow other controllers to register. This mimics SNET Pro behaviour.
                 // It's unknown why the first data byte must be odd.
                 if (non_nasa_keepalive)
                 {
-                    delay(30);
-                    send_register_controller(target);
+                    keepalive_timer.callback = [target]()
+                    {
+                        send_register_controller(target);
+                    };
+                    target->get_timers().schedule(keepalive_timer, target->get_miliseconds() + 30);
                 }
             }
         }
 
+        void NonNasaProtocol::add_poll(DeviceAddress, uint16_t, uint32_t, uint8_t)
+        {
+            // Non-NASA has no read requests, the units send their state on their own
+            ESP_LOGW(TAG, "polling is only supported by NASA devices");
+        }
+
         void NonNasaProtocol::protocol_update(MessageTarget *target)
         {
             // If we're not currently registered, keep sending a registration request until it has
@@ -653,39 +926,7 @@ namespace esphome
                 send_register_controller(target);
             }
 
-            // If we have *any* messages in the queue for longer than 15s, assume failure and
-            // remove from queue (the AC or UART connection is likely offline).
-            const uint32_t now = millis();
-            nonnasa_requests.remove_if([&](const NonNasaRequestQueueItem &item)
-                                       { return now - item.time > 15000; });
-
-            // If we have any *sent* messages in the queue that haven't received an ack in under 5s,
-            // assume they failed and queue for resend on the next request_control message. Retry at
-            // most 3 times.
-            for (auto &item : nonnasa_requests)
-            {
-                if (item.time_sent > 0 && item.resend_count < 3 && now - item.time_sent > 4500)
-                {
-                    item.time_sent = 0; // Resend
-                    item.resend_count++;
-                }
-            }
-
-            // If we have any *unsent* messages in the queue for over 1000ms, it likely means the indoor
-            // and/or outdoor unit has gone to sleep due to inactivity. Send a registration request to
-            // wake the unit up.
-            for (auto &item : nonnasa_requests)
-            {
-                if (item.time_sent == 0 && now - item.time > 1000 && item.resend_count == 0 && item.retry_count == 0)
-                {
-                    // Both the outdoor and the indoor unit must be awake before we can send a command
-                    indoor_unit_awake = false;
-                    item.retry_count++;
-                    ESP_LOGD(TAG, "Device is likely sleeping, waking...");
-                    send_register_controller(target);
-                    break;
-                }
-            }
+            // Expiry, resends and wake ups of queued requests run on the timers of the target
         }
     } // namespace samsung_ac
 } // namespace esphome
@@ -1,6 +1,5 @@
 #pragma once
 
-#include <list>
 #include <vector>
 #include <optional>
 #include "protocol.h"
@@ -145,10 +144,15 @@ namespace esphome
             CmdF8 = 0xF8,
         };
 
+        // Well known addresses on the Non-NASA bus
+        static constexpr uint8_t NON_NASA_OUTDOOR = 0xc8;
+        static constexpr uint8_t NON_NASA_CONTROLLER = 0xd0; // used by us
+        static constexpr uint8_t NON_NASA_BROADCAST = 0xad;
+
         struct NonNasaDataPacket
         {
-            std::string src;
-            std::string dst;
+            uint8_t src = 0;
+            uint8_t dst = 0;
 
             NonNasaCommand cmd;
 
@@ -170,13 +174,13 @@ namespace esphome
                 NonNasaCommandRaw commandRaw;
             };
 
-            DecodeResult decode(std::vector<uint8_t> &data);
+            DecodeResult decode(ByteSpan data);
             std::string to_string();
         };
 
         struct NonNasaRequest
         {
-            std::string dst;
+            uint8_t dst = 0;
 
             uint8_t room_temp = 0;
             uint8_t target_temp = 0;
@@ -187,23 +191,144 @@ namespace esphome
             std::vector<uint8_t> encode();
             std::string to_string();
 
-            static NonNasaRequest create(std::string dst_address);
+            static NonNasaRequest create(uint8_t dst_address);
+        };
+
+        // Last Cmd20 state of the indoor units. The address indexes into a small table of states,
+        // so a lookup neither allocates nor searches.
+        class NonNasaStateTable
+        {
+        public:
+            static constexpr uint8_t CAPACITY = 8;
+
+            // Returns nullptr when nothing was received from the unit yet.
+            const NonNasaCommand20 *find(uint8_t address) const;
+            void update(uint8_t address, const NonNasaCommand20 &state);
+            void clear();
+
+        protected:
+            uint8_t index_[256] = {}; // slot + 1, 0 for unknown units
+            NonNasaCommand20 states_[CAPACITY];
+            uint8_t size_ = 0;
         };
 
         struct NonNasaRequestQueueItem
         {
+            bool used = false;
             NonNasaRequest request;
-            uint32_t time;
-            uint32_t time_sent;
-            uint8_t retry_count;
-            uint8_t resend_count;
+            uint32_t time = 0;
+            bool sent = false; // waits for its ack
+            uint32_t time_sent = 0;
+            uint8_t retry_count = 0;
+            uint8_t resend_count = 0;
+            std::vector<uint8_t> data; // encoded request, ready for the next request_control window
+            WheelTimer expire_timer;
+            WheelTimer retry_timer; // wakes the units while unsent, resends after it was sent
+        };
+
+        // Pending control requests with one slot for each indoor unit. A new request for a unit
+        // which has a pending one is merged into its slot instead of queuing behind it. Iterating
+        // visits all slots, unused ones included.
+        class NonNasaRequestQueue
+        {
+        public:
+            static constexpr uint8_t CAPACITY = 8;
+
+            NonNasaRequestQueueItem *find(uint8_t dst);
+            // Returns a free slot for dst, nullptr when all slots are used.
+            NonNasaRequestQueueItem *allocate(uint8_t dst);
+            void remove(NonNasaRequestQueueItem &item);
+            void clear();
+            size_t size() const;
+
+            NonNasaRequestQueueItem *begin() { return items_; }
+            NonNasaRequestQueueItem *end() { return items_ + CAPACITY; }
+
+        protected:
+            NonNasaRequestQueueItem items_[CAPACITY];
+        };
+
+        extern NonNasaRequestQueue nonnasa_requests;
+
+        // Measures how the outdoor unit polls us (request_control), how fast control messages are
+        // acknowledged and how long the units need to wake up, and derives the request timeouts
+        // from it. Until something was measured the timeouts are the ones known from SNET Pro.
+        // Non-NASA has a single outdoor unit (c8), so there is one set of measurements.
+        class NonNasaTiming
+        {
+        public:
+            static constexpr uint32_t DEFAULT_WAKE_DELAY = 1000;
+            static constexpr uint32_t DEFAULT_RESEND_TIMEOUT = 4500;
+            static constexpr uint32_t MAX_EXPIRE_TIMEOUT = 15000;
+            static constexpr uint8_t MAX_RESENDS = 3;
+            static constexpr uint32_t DEFAULT_POLL_INTERVAL = 1000;
+            // Bus time of one frame. Frames are only timestamped when they are processed, which
+            // is too coarse to measure it.
+            static constexpr uint32_t FRAME_TIME = 14 * 10 * 1000 / 2400; // 14 bytes at 2400 baud
+
+            void poll_received(uint32_t now);
+            void ack_received(uint32_t latency);
+            void wake_sent(uint32_t now);
+            void clear();
+
+            // The unit stopped polling, so it is likely asleep and has to be woken up first.
+            bool likely_asleep(uint32_t now) const;
+            // How long an unsent request waits for a poll before the units are woken up.
+            uint32_t wake_delay() const;
+            // How long a sent request waits for its ack before it is resent.
+            uint32_t resend_timeout() const;
+            // How long a request stays in the queue before it is dropped.
+            uint32_t expire_timeout() const;
+            // Bus time of a control message including the ack of the unit.
+            uint32_t request_time() const;
+
+            // averaged measurements in ms, 0 until measured
+            uint32_t poll_interval() const { return poll_interval_; }
+            uint32_t ack_latency() const { return ack_latency_; }
+            uint32_t wake_latency() const { return wake_latency_; }
+
+        protected:
+            uint32_t poll_interval_ = 0;
+            uint32_t ack_latency_ = 0;
+            uint32_t wake_latency_ = 0;
+            uint32_t last_poll_ = 0;
+            uint32_t wake_sent_ = 0;
+            bool polled_ = false;
+            bool waking_ = false;
+        };
+
+        extern NonNasaTiming nonnasa_timing;
+
+        // Sends the queued requests when the outdoor unit polls us with request_control. Every
+        // request is answered with an ack by its unit, so the requests are paced by the time of
+        // both frames and only as many are sent as fit before the next poll. The remaining ones
+        // are sent in the next window.
+        class NonNasaDispatcher
+        {
+        public:
+            void start(MessageTarget *target, uint32_t now);
+            // Sends a request which was queued while a window is open and no other one is waiting
+            // for its ack.
+            void request_queued(MessageTarget *target);
+            void clear()
+            {
+                timer_.cancel();
+                window_open_ = false;
+            }
+
+        protected:
+            void dispatch(MessageTarget *target);
+
+            WheelTimer timer_;
+            uint32_t window_end_ = 0;
+            bool window_open_ = false;
         };
 
-        extern std::list<NonNasaRequestQueueItem> nonnasa_requests;
+        extern NonNasaDispatcher nonnasa_dispatcher;
         extern bool controller_registered;
         extern bool indoor_unit_awake;
 
-        DecodeResult try_decode_non_nasa_packet(std::vector<uint8_t> data);
+        DecodeResult try_decode_non_nasa_packet(ByteSpan data);
         void process_non_nasa_packet(MessageTarget *target);
 
         class NonNasaProtocol : public Protocol
@@ -211,8 +336,9 @@ namespace esphome
         public:
             NonNasaProtocol() = default;
 
-            void publish_request(MessageTarget *target, const std::string &address, ProtocolRequest &request) override;
+            void publish_request(MessageTarget *target, DeviceAddress address, ProtocolRequest &request) override;
             void protocol_update(MessageTarget *target) override;
+            void add_poll(DeviceAddress address, uint16_t message_number, uint32_t interval, uint8_t priority) override;
         };
     } // namespace samsung_ac
 } // namespace esphome
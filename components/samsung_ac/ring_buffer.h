@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include "util.h"
+
+namespace esphome
+{
+  namespace samsung_ac
+  {
+    // Statically sized byte ring buffer used for UART RX.
+    //
+    // Bytes are appended at the write cursor. The read cursor marks the next byte which was not
+    // looked at yet (i.e. fed into the frame parser) and the commit cursor marks the first byte which
+    // is still needed. Bytes before the commit cursor are free again. This lets a partial frame,
+    // preamble bytes and the following frame sit side by side without any reallocation.
+    //
+    // The cursors are free running counters, N must be a power of two.
+    template <size_t N>
+    class RingBuffer
+    {
+      static_assert(N > 0 && (N & (N - 1)) == 0, "RingBuffer size must be a power of two");
+
+    public:
+      // bytes between commit and write cursor
+      size_t size() const { return write_ - commit_; }
+      size_t free() const { return N - size(); }
+      // bytes between read and write cursor
+      size_t unread() const { return write_ - read_; }
+      // bytes between commit and read cursor
+      size_t read_size() const { return read_ - commit_; }
+      static constexpr size_t capacity() { return N; }
+
+      bool push(uint8_t c)
+      {
+        if (free() == 0)
+          return false;
+        buffer_[write_ & MASK] = c;
+        write_++;
+        return true;
+      }
+
+      // Start and length of the contiguous free space at the write cursor, used for bulk reads.
+      // Call produce() with the number of bytes which were written there.
+      uint8_t *write_ptr() { return buffer_ + (write_ & MASK); }
+      size_t write_size() const { return std::min(free(), N - (size_t)(write_ & MASK)); }
+      void produce(size_t count)
+      {
+        write_ += std::min(count, write_size());
+      }
+
+      // Returns the next unread byte and advances the read cursor. Only valid if unread() > 0.
+      uint8_t read()
+      {
+        return buffer_[read_++ & MASK];
+      }
+
+      // Returns the byte at the given offset from the commit cursor. Only valid if offset < size().
+      uint8_t at(size_t offset) const
+      {
+        return buffer_[(commit_ + offset) & MASK];
+      }
+
+      // Releases count bytes from the commit cursor. The read cursor is moved along if needed.
+      void commit(size_t count)
+      {
+        commit_ += std::min(count, size());
+        if ((int32_t)(read_ - commit_) < 0)
+          read_ = commit_;
+      }
+
+      // Moves the read cursor back to the commit cursor, all bytes will be read again.
+      void rewind()
+      {
+        read_ = commit_;
+      }
+
+      void clear()
+      {
+        commit_ = read_ = write_;
+      }
+
+      // Returns a contiguous view of the first count bytes after the commit cursor. Only when these
+      // bytes wrap around the end of the storage, the storage is rotated in place once.
+      ByteSpan linearize(size_t count)
+      {
+        count = std::min(count, size());
+        const size_t offset = commit_ & MASK;
+        if (offset + count > N)
+        {
+          std::rotate(buffer_, buffer_ + offset, buffer_ + N);
+          commit_ -= offset;
+          read_ -= offset;
+          write_ -= offset;
+        }
+        return ByteSpan(buffer_ + (commit_ & MASK), count);
+      }
+
+    protected:
+      static constexpr uint32_t MASK = N - 1;
+
+      uint8_t buffer_[N];
+      uint32_t write_ = 0;
+      uint32_t read_ = 0;
+      uint32_t commit_ = 0;
+    };
+  } // namespace samsung_ac
+} // namespace esphome
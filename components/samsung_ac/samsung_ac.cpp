@@ -1,13 +1,29 @@
 #include "esphome/core/log.h"
 #include "samsung_ac.h"
 #include "debug_mqtt.h"
+#include "protocol_nasa.h"
+#include "protocol_non_nasa.h"
 #include "util.h"
 #include <vector>
+#include <algorithm>
 
 namespace esphome
 {
   namespace samsung_ac
   {
+    Samsung_AC::Samsung_AC()
+    {
+      // fires 500ms after the last received byte, an incomplete frame will not be finished anymore
+      rx_stale_timer_.callback = [this]()
+      {
+        if (transceiver_.rx_stalled())
+        {
+          ESP_LOGW(TAG, "Last transmission too long ago. Resynchronize RX.");
+          transceiver_.resync();
+        }
+      };
+    }
+
     void Samsung_AC::setup()
     {
       if (debug_log_messages)
@@ -23,14 +39,12 @@ namespace esphome
         ESP_LOGW(TAG, "update");
       }
 
-      for (const auto &pair : devices_)
+      for (Samsung_AC_Device *device : devices_)
       {
-        optional<Mode> current_value = pair.second->_cur_mode;
-        std::string address = pair.second->address;
-
+        optional<Mode> current_value = device->_cur_mode;
         if (current_value.has_value())
         {
-          state_tracker_.update(address, current_value.value());
+          state_tracker_.update(device->address, current_value.value());
         }
       }
 
@@ -44,11 +58,11 @@ namespace esphome
       }
 
       std::string devices;
-      for (const auto &pair : devices_)
+      for (Samsung_AC_Device *device : devices_)
       {
         if (!devices.empty())
           devices += ", ";
-        devices += pair.second->address;
+        devices += device->address.to_string();
       }
       ESP_LOGCONFIG(TAG, "Configured devices: %s", devices.c_str());
 
@@ -59,9 +73,37 @@ namespace esphome
                                                                                                                                                : knownOther;
         if (!target.empty())
           target += ", ";
-        target += address;
+        target += address.to_string();
       }
 
+      const auto &bus = transceiver_.stats();
+      ESP_LOGCONFIG(TAG, "RX: salvaged %u bytes, discarded %u bytes", (unsigned)bus.rx_salvaged_bytes, (unsigned)bus.rx_discarded_bytes);
+      if (protocol_processing != ProtocolProcessing::NonNASA)
+      {
+        const auto &tx = nasa_transactions.stats();
+        ESP_LOGCONFIG(TAG, "TX: %u acknowledged, %u rejected, %u retries, %u expired, rtt %u ms (max %u ms)",
+                      (unsigned)tx.completed, (unsigned)tx.nacked, (unsigned)tx.retries, (unsigned)tx.expired,
+                      (unsigned)tx.last_rtt, (unsigned)tx.max_rtt);
+      }
+      const auto &sequence = nasa_sequence_tracker.stats();
+      if (received_packets_sensor_ != nullptr)
+        received_packets_sensor_->publish_state(sequence.received);
+      if (duplicate_packets_sensor_ != nullptr)
+        duplicate_packets_sensor_->publish_state(sequence.duplicates);
+      if (missing_packets_sensor_ != nullptr)
+        missing_packets_sensor_->publish_state(sequence.missing);
+
+      // timings are only published once they were measured
+      if (non_nasa_poll_interval_sensor_ != nullptr && nonnasa_timing.poll_interval() > 0)
+        non_nasa_poll_interval_sensor_->publish_state(nonnasa_timing.poll_interval());
+      if (non_nasa_ack_latency_sensor_ != nullptr && nonnasa_timing.ack_latency() > 0)
+        non_nasa_ack_latency_sensor_->publish_state(nonnasa_timing.ack_latency());
+      if (non_nasa_wake_latency_sensor_ != nullptr && nonnasa_timing.wake_latency() > 0)
+        non_nasa_wake_latency_sensor_->publish_state(nonnasa_timing.wake_latency());
+
+      ESP_LOGCONFIG(TAG, "TX: %u echoes, %u collisions, %u busy bus backoffs, %u frames dropped",
+                    (unsigned)bus.tx_echoes, (unsigned)bus.tx_collisions, (unsigned)bus.tx_busy_backoffs, (unsigned)bus.tx_dropped);
+
       ESP_LOGCONFIG(TAG, "Discovered devices:");
       ESP_LOGCONFIG(TAG, "  Outdoor: %s", (knownOutdoor.length() == 0 ? "-" : knownOutdoor.c_str()));
       ESP_LOGCONFIG(TAG, "  Indoor:  %s", (knownIndoor.length() == 0 ? "-" : knownIndoor.c_str()));
@@ -75,22 +117,38 @@ namespace esphome
     {
       if (find_device(device->address) != nullptr)
       {
-        ESP_LOGW(TAG, "There is already and device for address %s registered.", device->address.c_str());
+        ESP_LOGW(TAG, "There is already and device for address %s registered.", device->address.to_string().c_str());
         return;
       }
 
-      devices_.insert({device->address, device});
+      auto it = std::lower_bound(devices_.begin(), devices_.end(), device, [](Samsung_AC_Device *a, Samsung_AC_Device *b)
+                                 { return a->address < b->address; });
+      devices_.insert(it, device);
+
+      Protocol *protocol = device->get_device_protocol();
+      if (protocol != nullptr && std::find(protocols_.begin(), protocols_.end(), protocol) == protocols_.end())
+        protocols_.push_back(protocol);
     }
 
     void Samsung_AC::dump_config()
     {
     }
 
-    void Samsung_AC::publish_data(std::vector<uint8_t> &data)
+    void Samsung_AC::publish_data(std::vector<uint8_t> &data, TxPriority priority)
     {
-      ESP_LOGW(TAG, "write %s", bytes_to_hex(data).c_str());
-      this->write_array(data);
+      transceiver_.push(data, priority);
+    }
+
+    void Samsung_AC::send_tx_queue(uint32_t now)
+    {
+      const std::vector<uint8_t> *frame = transceiver_.next_tx(now, available() > 0);
+      if (frame == nullptr)
+        return;
+
+      ESP_LOGW(TAG, "write %s", bytes_to_hex(*frame).c_str());
+      this->write_array(*frame);
       this->flush();
+      transceiver_.sent(millis());
     }
 
     void Samsung_AC::loop()
@@ -99,40 +157,53 @@ namespace esphome
         return;
 
       const uint32_t now = millis();
-      if (!data_.empty() && (now - last_transmission_ >= 500))
-      {
-        ESP_LOGW(TAG, "Last transmission too long ago. Reset RX index.");
-        data_.clear();
-      }
+      timers_.advance(now);
 
-      while (available())
+      // Drain the UART and process as many frames as fit into the time budget. Processing
+      // frees buffer space, so the UART is read again after each frame.
+      read_uart();
+      if (!transceiver_.tx_echo_pending() || transceiver_.match_tx_echo(now))
       {
-        last_transmission_ = now;
-        uint8_t c;
-        if (!read_byte(&c))
-          continue;
-        if (data_.empty() && c != 0x32)
-          continue; // skip until start-byte found
-
-        data_.push_back(c);
-
-        if (process_data(data_, this) == DataResult::Clear)
+        while (transceiver_.process_rx(this))
         {
-          data_.clear();
-          break; // wait for next loop
+          read_uart();
+          if (millis() - now >= rx_time_budget_)
+            break; // continue with next loop
         }
       }
 
+      for (Samsung_AC_Device *device : devices_)
+      {
+        device->flush_pending_request(now);
+      }
+
       // Allow device protocols to perform recurring tasks (at most every 200ms)
       if (now - last_protocol_update_ >= 200)
       {
         last_protocol_update_ = now;
-        for (const auto &pair : devices_)
+        for (Protocol *protocol : protocols_)
         {
-          Samsung_AC_Device *device = pair.second;
-          device->protocol_update(this);
+          protocol->protocol_update(this);
         }
       }
+
+      send_tx_queue(millis());
+    }
+
+    void Samsung_AC::read_uart()
+    {
+      auto &rx_buffer = transceiver_.rx_buffer();
+      int count;
+      while ((count = available()) > 0 && rx_buffer.free() > 0)
+      {
+        const size_t size = std::min((size_t)count, rx_buffer.write_size());
+        if (!read_array(rx_buffer.write_ptr(), size))
+          break;
+        rx_buffer.produce(size);
+        const uint32_t now = millis();
+        transceiver_.received(now);
+        timers_.schedule(rx_stale_timer_, now + 500);
+      }
     }
 
     float Samsung_AC::get_setup_priority() const { return setup_priority::DATA; }
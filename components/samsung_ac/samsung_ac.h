@@ -1,14 +1,13 @@
 #pragma once
 
-#include <set>
-#include <map>
-#include <optional>
-#include <queue>
+#include <vector>
+#include <algorithm>
 #include "esphome/core/component.h"
 #include "esphome/components/uart/uart.h"
 #include "samsung_ac_device.h"
 #include "protocol.h"
 #include "device_state_tracker.h"
+#include "transceiver.h"
 
 namespace esphome
 {
@@ -22,7 +21,7 @@ namespace esphome
                        public MessageTarget
     {
     public:
-      Samsung_AC() = default;
+      Samsung_AC();
 
       float get_setup_priority() const override;
       void setup() override;
@@ -56,162 +55,111 @@ namespace esphome
       {
         debug_log_undefined_messages = value;
       }
-      void register_device(Samsung_AC_Device *device);
 
-      void /*MessageTarget::*/ register_address(const std::string address) override
+      void set_rx_time_budget(uint32_t value)
       {
-        addresses_.insert(address);
+        rx_time_budget_ = value;
       }
 
-      uint32_t /*MessageTarget::*/ get_miliseconds()
+      void set_tx_idle_gap(uint32_t value)
       {
-        return millis();
+        transceiver_.set_tx_idle_gap(value);
       }
 
-      void /*MessageTarget::*/ publish_data(std::vector<uint8_t> &data);
-
-      void /*MessageTarget::*/ set_room_temperature(const std::string address, float value) override
+      void set_received_packets_sensor(sensor::Sensor *sensor)
       {
-        Samsung_AC_Device *dev = find_device(address);
-        if (dev != nullptr)
-          dev->update_room_temperature(value);
+        received_packets_sensor_ = sensor;
       }
 
-      void /*MessageTarget::*/ set_outdoor_temperature(const std::string address, float value) override
+      void set_duplicate_packets_sensor(sensor::Sensor *sensor)
       {
-        Samsung_AC_Device *dev = find_device(address);
-        if (dev != nullptr)
-          dev->update_outdoor_temperature(value);
+        duplicate_packets_sensor_ = sensor;
       }
 
-      void /*MessageTarget::*/ set_indoor_eva_in_temperature(const std::string address, float value) override
+      void set_missing_packets_sensor(sensor::Sensor *sensor)
       {
-        Samsung_AC_Device *dev = find_device(address);
-        if (dev != nullptr)
-          dev->update_indoor_eva_in_temperature(value);
+        missing_packets_sensor_ = sensor;
       }
 
-      void /*MessageTarget::*/ set_indoor_eva_out_temperature(const std::string address, float value) override
+      void set_non_nasa_poll_interval_sensor(sensor::Sensor *sensor)
       {
-        Samsung_AC_Device *dev = find_device(address);
-        if (dev != nullptr)
-          dev->update_indoor_eva_out_temperature(value);
+        non_nasa_poll_interval_sensor_ = sensor;
       }
 
-      void /*MessageTarget::*/ set_target_temperature(const std::string address, float value) override
+      void set_non_nasa_ack_latency_sensor(sensor::Sensor *sensor)
       {
-        Samsung_AC_Device *dev = find_device(address);
-        if (dev != nullptr)
-          dev->update_target_temperature(value);
+        non_nasa_ack_latency_sensor_ = sensor;
       }
 
-      void /*MessageTarget::*/ set_water_outlet_target(const std::string address, float value) override
+      void set_non_nasa_wake_latency_sensor(sensor::Sensor *sensor)
       {
-        Samsung_AC_Device *dev = find_device(address);
-        if (dev != nullptr)
-          dev->update_water_outlet_target(value);
+        non_nasa_wake_latency_sensor_ = sensor;
       }
+      void register_device(Samsung_AC_Device *device);
 
-      void /*MessageTarget::*/ set_target_water_temperature(const std::string address, float value) override
+      void /*MessageTarget::*/ register_address(DeviceAddress address) override
       {
-        Samsung_AC_Device *dev = find_device(address);
-        if (dev != nullptr)
-          dev->update_target_water_temperature(value);
+        auto it = std::lower_bound(addresses_.begin(), addresses_.end(), address);
+        if (it == addresses_.end() || *it != address)
+          addresses_.insert(it, address);
       }
 
-      void /*MessageTarget::*/ set_power(const std::string address, bool value) override
-      {
-        Samsung_AC_Device *dev = find_device(address);
-        if (dev != nullptr)
-          dev->update_power(value);
-      }
-      void /*MessageTarget::*/ set_automatic_cleaning(const std::string address, bool value) override
-      {
-        Samsung_AC_Device *dev = find_device(address);
-        if (dev != nullptr)
-          dev->update_automatic_cleaning(value);
-      }
-      void /*MessageTarget::*/ set_water_heater_power(const std::string address, bool value) override
+      uint32_t /*MessageTarget::*/ get_miliseconds()
       {
-        Samsung_AC_Device *dev = find_device(address);
-        if (dev != nullptr)
-          dev->update_water_heater_power(value);
+        return millis();
       }
 
-      void /*MessageTarget::*/ set_mode(const std::string address, Mode mode) override
-      {
-        Samsung_AC_Device *dev = find_device(address);
-        if (dev != nullptr)
-          dev->update_mode(mode);
-      }
+      void /*MessageTarget::*/ publish_data(std::vector<uint8_t> &data, TxPriority priority) override;
 
-      void /*MessageTarget::*/ set_water_heater_mode(const std::string address, WaterHeaterMode waterheatermode) override
+      ProtocolTimers & /*MessageTarget::*/ get_timers() override
       {
-        Samsung_AC_Device *dev = find_device(address);
-        if (dev != nullptr)
-          dev->update_water_heater_mode(waterheatermode);
+        return timers_;
       }
 
-      void /*MessageTarget::*/ set_fanmode(const std::string address, FanMode fanmode) override
+      void /*MessageTarget::*/ set_state(DeviceAddress address, const DeviceState &state) override
       {
         Samsung_AC_Device *dev = find_device(address);
         if (dev != nullptr)
-          dev->update_fanmode(fanmode);
+          dev->update_state(state);
       }
 
-      void /*MessageTarget::*/ set_altmode(const std::string address, AltMode altmode) override
-      {
-        Samsung_AC_Device *dev = find_device(address);
-        if (dev != nullptr)
-          dev->update_altmode(altmode);
-      }
+    protected:
+      void read_uart();
+      void send_tx_queue(uint32_t now);
 
-      void /*MessageTarget::*/ set_swing_vertical(const std::string address, bool vertical) override
+      Samsung_AC_Device *find_device(DeviceAddress address)
       {
-        Samsung_AC_Device *dev = find_device(address);
-        if (dev != nullptr)
-          dev->update_swing_vertical(vertical);
+        auto it = std::lower_bound(devices_.begin(), devices_.end(), address, [](Samsung_AC_Device *device, DeviceAddress address)
+                                   { return device->address < address; });
+        if (it != devices_.end() && (*it)->address == address)
+          return *it;
+        return nullptr;
       }
 
-      void /*MessageTarget::*/ set_swing_horizontal(const std::string address, bool horizontal) override
-      {
-        Samsung_AC_Device *dev = find_device(address);
-        if (dev != nullptr)
-          dev->update_swing_horizontal(horizontal);
-      }
+      // both sorted by address, looked up with a binary search for every message
+      std::vector<Samsung_AC_Device *> devices_;
+      std::vector<DeviceAddress> addresses_;
+      std::vector<Protocol *> protocols_; // distinct protocols of the devices, updated once per tick
+      DeviceStateTracker<Mode> state_tracker_{1000};
 
-      void /*MessageTarget::*/ set_custom_sensor(const std::string address, uint16_t message_number, float value) override
-      {
-        Samsung_AC_Device *dev = find_device(address);
-        if (dev != nullptr)
-          dev->update_custom_sensor(message_number, value);
-      }
+      Transceiver transceiver_;
 
-      void /*MessageTarget::*/ set_error_code(const std::string address, int value) override
-      {
-        Samsung_AC_Device *dev = find_device(address);
-        if (dev != nullptr)
-          dev->update_error_code(value);
-      }
+      // All protocol timeouts run on this wheel, so a loop only touches the timers which are due
+      ProtocolTimers timers_;
+      WheelTimer rx_stale_timer_;
 
-    protected:
-      Samsung_AC_Device *find_device(const std::string address)
-      {
-        auto it = devices_.find(address);
-        if (it != devices_.end())
-        {
-          return it->second;
-        }
-        return nullptr;
-      }
+      uint32_t last_protocol_update_ = 0;
+      uint32_t rx_time_budget_ = 10;
 
-      std::map<std::string, Samsung_AC_Device *> devices_;
-      DeviceStateTracker<Mode> state_tracker_{1000};
-      std::set<std::string> addresses_;
+      // NASA packet sequence statistics, published on update()
+      sensor::Sensor *received_packets_sensor_{nullptr};
+      sensor::Sensor *duplicate_packets_sensor_{nullptr};
+      sensor::Sensor *missing_packets_sensor_{nullptr};
 
-      std::vector<uint8_t> data_;
-      uint32_t last_transmission_ = 0;
-      uint32_t last_protocol_update_ = 0;
+      // measured Non-NASA timing, published on update()
+      sensor::Sensor *non_nasa_poll_interval_sensor_{nullptr};
+      sensor::Sensor *non_nasa_ack_latency_sensor_{nullptr};
+      sensor::Sensor *non_nasa_wake_latency_sensor_{nullptr};
 
       bool data_processing_init = true;
 
@@ -39,7 +39,7 @@ namespace esphome
         fan.insert(climate::ClimateFanMode::CLIMATE_FAN_AUTO);
       }
 
-      if (is_nasa_address(device->address))
+      if (device->address.is_nasa())
       {
         // fan.insert(climate::ClimateFanMode::CLIMATE_FAN_DIFFUSE);
       }
@@ -1,8 +1,10 @@
 #pragma once
 
 #include <set>
+#include <cmath>
 #include <optional>
 #include <algorithm>
+#include "esphome/core/hal.h"
 #include "esphome/core/helpers.h"
 #include "esphome/components/switch/switch.h"
 #include "esphome/components/sensor/sensor.h"
@@ -12,6 +14,7 @@
 #include "protocol.h"
 #include "samsung_ac.h"
 #include "conversions.h"
+#include "shadow_value.h"
 
 namespace esphome
 {
@@ -73,6 +76,46 @@ namespace esphome
       std::function<void(WaterHeaterMode)> write_state_;
     };
 
+    // Select bound to an arbitrary message number, each option maps to one message value.
+    class Samsung_AC_Custom_Select : public select::Select
+    {
+    public:
+      void add_option(long value, const std::string &name)
+      {
+        options_.push_back({value, name});
+      }
+
+      void publish_value(long value)
+      {
+        for (const auto &option : options_)
+        {
+          if (option.first == value)
+          {
+            this->publish_state(option.second);
+            return;
+          }
+        }
+        ESP_LOGW(TAG, "No select option for value %ld", value);
+      }
+
+      void control(const std::string &value) override
+      {
+        for (const auto &option : options_)
+        {
+          if (option.second == value)
+          {
+            write_state_(option.first);
+            return;
+          }
+        }
+      }
+
+      std::function<void(long)> write_state_;
+
+    protected:
+      std::vector<std::pair<long, std::string>> options_;
+    };
+
     class Samsung_AC_Switch : public switch_::Switch
     {
     public:
@@ -86,10 +129,29 @@ namespace esphome
       }
     };
 
-    struct Samsung_AC_Sensor
+    // Entity which is bound to a message number by the custom_* yaml options.
+    struct MessageBinding
     {
+      enum class Kind : uint8_t
+      {
+        Sensor,
+        Number,
+        Switch,
+        Select,
+      };
+
       uint16_t message_number;
-      sensor::Sensor *sensor;
+      Kind kind;
+      float divisor{1};   // numbers only, value = raw / divisor
+      bool scaled{false}; // sensors only, publish the value scaled by the message registry
+      union
+      {
+        sensor::Sensor *sensor;
+        Samsung_AC_Number *number;
+        Samsung_AC_Switch *switch_;
+        Samsung_AC_Custom_Select *select;
+      };
+      ShadowValue shadow;
     };
 
     class Samsung_AC_Device
@@ -97,12 +159,12 @@ namespace esphome
     public:
       Samsung_AC_Device(const std::string &address, MessageTarget *target)
       {
-        this->address = address;
+        this->address = DeviceAddress::parse(address);
         this->target = target;
-        this->protocol = get_protocol(address);
+        this->protocol = get_protocol(this->address);
       }
 
-      std::string address;
+      DeviceAddress address;
       sensor::Sensor *room_temperature{nullptr};
       sensor::Sensor *outdoor_temperature{nullptr};
       sensor::Sensor *indoor_eva_in_temperature{nullptr};
@@ -117,7 +179,8 @@ namespace esphome
       Samsung_AC_Mode_Select *mode{nullptr};
       Samsung_AC_Water_Heater_Mode_Select *waterheatermode{nullptr};
       Samsung_AC_Climate *climate{nullptr};
-      std::vector<Samsung_AC_Sensor> custom_sensors;
+      // sorted by message number, see add_binding()
+      std::vector<MessageBinding> bindings;
       float room_temperature_offset{0};
 
       void set_room_temperature_sensor(sensor::Sensor *sensor)
@@ -147,10 +210,80 @@ namespace esphome
 
       void add_custom_sensor(int message_number, sensor::Sensor *sensor)
       {
-        Samsung_AC_Sensor cust_sensor;
-        cust_sensor.message_number = (uint16_t)message_number;
-        cust_sensor.sensor = sensor;
-        custom_sensors.push_back(std::move(cust_sensor));
+        MessageBinding binding;
+        binding.kind = MessageBinding::Kind::Sensor;
+        binding.sensor = sensor;
+        add_binding(message_number, binding);
+      }
+
+      // Sensor of a known message, its value is scaled as described by the message registry
+      // instead of raw_filters in the yaml.
+      void add_message_sensor(int message_number, sensor::Sensor *sensor)
+      {
+        MessageBinding binding;
+        binding.kind = MessageBinding::Kind::Sensor;
+        binding.sensor = sensor;
+        binding.scaled = true;
+        add_binding(message_number, binding);
+      }
+
+      void add_custom_number(int message_number, Samsung_AC_Number *number, float divisor)
+      {
+        if (!is_writable_message(message_number))
+        {
+          ESP_LOGW(TAG, "Message 0x%04x is a structure and cannot be written, ignoring custom number", message_number);
+          return;
+        }
+
+        MessageBinding binding;
+        binding.kind = MessageBinding::Kind::Number;
+        binding.number = number;
+        binding.divisor = divisor;
+        add_binding(message_number, binding);
+
+        number->write_state_ = [this, message_number, divisor](float value)
+        {
+          publish_custom_message(message_number, lroundf(value * divisor));
+        };
+      }
+
+      void add_custom_switch(int message_number, Samsung_AC_Switch *switch_)
+      {
+        if (!is_writable_message(message_number))
+        {
+          ESP_LOGW(TAG, "Message 0x%04x is a structure and cannot be written, ignoring custom switch", message_number);
+          return;
+        }
+
+        MessageBinding binding;
+        binding.kind = MessageBinding::Kind::Switch;
+        binding.switch_ = switch_;
+        add_binding(message_number, binding);
+
+        switch_->write_state_ = [this, message_number](bool value)
+        {
+          invalidate_custom_shadow(message_number);
+          publish_custom_message(message_number, value ? 1 : 0);
+        };
+      }
+
+      void add_custom_select(int message_number, Samsung_AC_Custom_Select *select)
+      {
+        if (!is_writable_message(message_number))
+        {
+          ESP_LOGW(TAG, "Message 0x%04x is a structure and cannot be written, ignoring custom select", message_number);
+          return;
+        }
+
+        MessageBinding binding;
+        binding.kind = MessageBinding::Kind::Select;
+        binding.select = select;
+        add_binding(message_number, binding);
+
+        select->write_state_ = [this, message_number](long value)
+        {
+          publish_custom_message(message_number, value);
+        };
       }
 
       void set_power_switch(Samsung_AC_Switch *switch_)
@@ -158,6 +291,7 @@ namespace esphome
         power = switch_;
         power->write_state_ = [this](bool value)
         {
+          power_shadow_.invalidate();
           ProtocolRequest request;
           request.power = value;
           publish_request(request);
@@ -169,6 +303,7 @@ namespace esphome
         automatic_cleaning = switch_;
         automatic_cleaning->write_state_ = [this](bool value)
         {
+          automatic_cleaning_shadow_.invalidate();
           ProtocolRequest request;
           request.automatic_cleaning = value;
           publish_request(request);
@@ -180,6 +315,7 @@ namespace esphome
         water_heater_power = switch_;
         water_heater_power->write_state_ = [this](bool value)
         {
+          water_heater_power_shadow_.invalidate();
           ProtocolRequest request;
           request.water_heater_power = value;
           publish_request(request);
@@ -247,27 +383,84 @@ namespace esphome
         climate->device = this;
       }
 
-      void update_target_temperature(float value)
-      {
-        if (target_temperature != nullptr)
-          target_temperature->publish_state(value);
-        if (climate != nullptr)
+      // Applies all values of one packet. Every entity is published at most once, the climate
+      // only when one of its values changed (or on the heartbeat).
+      void update_state(const DeviceState &state)
+      {
+        bool climate_changed = false;
+        const bool climate_values = state.power || state.automatic_cleaning || state.mode || state.fanmode ||
+                                    state.altmode || state.swing_vertical || state.swing_horizontal ||
+                                    state.room_temperature || state.target_temperature;
+
+        if (state.power.has_value())
+          climate_changed |= update_power(state.power.value());
+        if (state.automatic_cleaning.has_value())
+          climate_changed |= update_automatic_cleaning(state.automatic_cleaning.value());
+        if (state.water_heater_power.has_value())
+          update_water_heater_power(state.water_heater_power.value());
+        if (state.mode.has_value())
+          climate_changed |= update_mode(state.mode.value());
+        if (state.water_heater_mode.has_value())
+          update_water_heater_mode(state.water_heater_mode.value());
+        if (state.fanmode.has_value())
+          climate_changed |= update_fanmode(state.fanmode.value());
+        if (state.altmode.has_value())
+          climate_changed |= update_altmode(state.altmode.value());
+        if (state.swing_vertical.has_value())
+          climate_changed |= update_swing_vertical(state.swing_vertical.value());
+        if (state.swing_horizontal.has_value())
+          climate_changed |= update_swing_horizontal(state.swing_horizontal.value());
+        if (state.room_temperature.has_value())
+          climate_changed |= update_room_temperature(state.room_temperature.value());
+        if (state.target_temperature.has_value())
+          climate_changed |= update_target_temperature(state.target_temperature.value());
+        if (state.water_outlet_target.has_value())
+          update_water_outlet_target(state.water_outlet_target.value());
+        if (state.target_water_temperature.has_value())
+          update_target_water_temperature(state.target_water_temperature.value());
+        if (state.outdoor_temperature.has_value())
+          update_outdoor_temperature(state.outdoor_temperature.value());
+        if (state.indoor_eva_in_temperature.has_value())
+          update_indoor_eva_in_temperature(state.indoor_eva_in_temperature.value());
+        if (state.indoor_eva_out_temperature.has_value())
+          update_indoor_eva_out_temperature(state.indoor_eva_out_temperature.value());
+        if (state.error_code.has_value())
+          update_error_code(state.error_code.value());
+        for (const auto &value : state.custom_sensors)
+          update_custom_sensor(value);
+
+        if (climate == nullptr || !climate_values)
+          return;
+
+        const uint32_t now = millis();
+        if (climate_changed || (publish_heartbeat_ > 0 && now - climate_last_publish_ >= publish_heartbeat_))
         {
-          climate->target_temperature = value;
+          climate_last_publish_ = now;
           climate->publish_state();
         }
       }
 
-      void update_water_outlet_target(float value)
+      // Only publish values which changed by at least the given amount, see ShadowValue.
+      void set_deadband(sensor::Sensor *sensor, float deadband)
       {
-        if (water_outlet_target != nullptr)
-          water_outlet_target->publish_state(value);
+        if (sensor == room_temperature)
+          room_temperature_shadow_.deadband = deadband;
+        if (sensor == outdoor_temperature)
+          outdoor_temperature_shadow_.deadband = deadband;
+        if (sensor == indoor_eva_in_temperature)
+          indoor_eva_in_temperature_shadow_.deadband = deadband;
+        if (sensor == indoor_eva_out_temperature)
+          indoor_eva_out_temperature_shadow_.deadband = deadband;
+        if (sensor == error_code)
+          error_code_shadow_.deadband = deadband;
+        for (auto &binding : bindings)
+          if (binding.kind == MessageBinding::Kind::Sensor && binding.sensor == sensor)
+            binding.shadow.deadband = deadband;
       }
 
-      void update_target_water_temperature(float value)
+      void set_publish_heartbeat(uint32_t value)
       {
-        if (target_water_temperature != nullptr)
-          target_water_temperature->publish_state(value);
+        publish_heartbeat_ = value;
       }
 
       optional<bool> _cur_power;
@@ -276,237 +469,386 @@ namespace esphome
       optional<Mode> _cur_mode;
       optional<WaterHeaterMode> _cur_water_heater_mode;
 
-      void update_power(bool value)
+      // Requests are collected for request_window ms and sent as one, so changing several values
+      // in quick succession (e.g. by an automation) does not end up in a packet for each of them.
+      void publish_request(ProtocolRequest &request)
+      {
+        if (request_window_ == 0)
+        {
+          protocol->publish_request(target, address, request);
+          return;
+        }
+
+        if (!has_pending_request_)
+        {
+          pending_request_ = ProtocolRequest();
+          pending_since_ = millis();
+          has_pending_request_ = true;
+        }
+        pending_request_.merge(request);
+      }
+
+      void flush_pending_request(uint32_t now)
+      {
+        if (!has_pending_request_ || now - pending_since_ < request_window_)
+          return;
+
+        has_pending_request_ = false;
+        protocol->publish_request(target, address, pending_request_);
+      }
+
+      void add_poll(int message_number, uint32_t interval, int priority)
+      {
+        protocol->add_poll(address, (uint16_t)message_number, interval, (uint8_t)priority);
+      }
+
+      void set_request_window(uint32_t value)
+      {
+        request_window_ = value;
+      }
+
+      bool supports_horizontal_swing()
+      {
+        return supports_horizontal_swing_;
+      }
+
+      bool supports_vertical_swing()
+      {
+        return supports_vertical_swing_;
+      }
+
+      void set_supports_horizontal_swing(bool value)
+      {
+        supports_horizontal_swing_ = value;
+      }
+
+      void set_supports_vertical_swing(bool value)
+      {
+        supports_vertical_swing_ = value;
+      }
+
+      void add_alt_mode(const AltModeName &name, AltMode value)
+      {
+        AltModeDesc desc;
+        desc.name = name;
+        desc.value = value;
+        alt_modes.push_back(std::move(desc));
+      }
+
+      const std::vector<AltModeDesc> *get_supported_alt_modes()
+      {
+        return &alt_modes;
+      }
+
+      void set_room_temperature_offset(float value)
+      {
+        room_temperature_offset = value;
+      }
+
+      Protocol *get_device_protocol() const
+      {
+        return protocol;
+      }
+
+    protected:
+      bool supports_horizontal_swing_{false};
+      bool supports_vertical_swing_{false};
+      std::vector<AltModeDesc> alt_modes;
+
+      Protocol *protocol{nullptr};
+      MessageTarget *target{nullptr};
+
+      uint32_t request_window_{0};
+      bool has_pending_request_{false};
+      uint32_t pending_since_{0};
+      ProtocolRequest pending_request_;
+
+      uint32_t publish_heartbeat_{0};
+      uint32_t climate_last_publish_{0};
+      ShadowValue room_temperature_shadow_;
+      ShadowValue outdoor_temperature_shadow_;
+      ShadowValue indoor_eva_in_temperature_shadow_;
+      ShadowValue indoor_eva_out_temperature_shadow_;
+      ShadowValue error_code_shadow_;
+      ShadowValue target_temperature_shadow_;
+      ShadowValue water_outlet_target_shadow_;
+      ShadowValue target_water_temperature_shadow_;
+      ShadowValue power_shadow_;
+      ShadowValue automatic_cleaning_shadow_;
+      ShadowValue water_heater_power_shadow_;
+      ShadowValue mode_shadow_;
+      ShadowValue water_heater_mode_shadow_;
+
+      bool publish_due(ShadowValue &shadow, float value)
+      {
+        return shadow.should_publish(value, millis(), publish_heartbeat_);
+      }
+
+      // The update_* methods publish their own entities when needed. The ones returning a bool
+      // also update the climate and return true if one of its values changed.
+      bool update_target_temperature(float value)
+      {
+        if (target_temperature != nullptr && publish_due(target_temperature_shadow_, value))
+          target_temperature->publish_state(value);
+        if (climate == nullptr || climate->target_temperature == value)
+          return false;
+        climate->target_temperature = value;
+        return true;
+      }
+
+      void update_water_outlet_target(float value)
+      {
+        if (water_outlet_target != nullptr && publish_due(water_outlet_target_shadow_, value))
+          water_outlet_target->publish_state(value);
+      }
+
+      void update_target_water_temperature(float value)
+      {
+        if (target_water_temperature != nullptr && publish_due(target_water_temperature_shadow_, value))
+          target_water_temperature->publish_state(value);
+      }
+
+      bool update_power(bool value)
       {
         _cur_power = value;
-        if (power != nullptr)
+        if (power != nullptr && publish_due(power_shadow_, value))
           power->publish_state(value);
-        if (climate != nullptr)
-          calc_and_publish_mode();
+        return calc_mode();
       }
 
-      void update_automatic_cleaning(bool value)
+      bool update_automatic_cleaning(bool value)
       {
         _cur_automatic_cleaning = value;
-        if (automatic_cleaning != nullptr)
+        if (automatic_cleaning != nullptr && publish_due(automatic_cleaning_shadow_, value))
           automatic_cleaning->publish_state(value);
-        if (climate != nullptr)
-          calc_and_publish_mode();
+        return calc_mode();
       }
 
       void update_water_heater_power(bool value)
       {
         _cur_water_heater_power = value;
-        if (water_heater_power != nullptr)
+        if (water_heater_power != nullptr && publish_due(water_heater_power_shadow_, value))
           water_heater_power->publish_state(value);
       }
 
-      void update_mode(Mode value)
+      bool update_mode(Mode value)
       {
         _cur_mode = value;
-        if (mode != nullptr)
+        if (mode != nullptr && publish_due(mode_shadow_, (float)value))
           mode->publish_state_(value);
-        if (climate != nullptr)
-          calc_and_publish_mode();
+        return calc_mode();
       }
 
       void update_water_heater_mode(WaterHeaterMode value)
       {
         _cur_water_heater_mode = value;
-        if (waterheatermode != nullptr)
+        if (waterheatermode != nullptr && publish_due(water_heater_mode_shadow_, (float)value))
           waterheatermode->publish_state_(value);
       }
 
-      void update_fanmode(FanMode value)
+      bool update_fanmode(FanMode value)
       {
-        if (climate != nullptr)
-        {
-          climate->fan_mode = fanmode_to_climatefanmode(value);
+        if (climate == nullptr)
+          return false;
 
-          auto fanmode = fanmode_to_climatefanmode(value);
-          if (fanmode.has_value())
-          {
-            climate->fan_mode = fanmode;
-            climate->custom_fan_mode.reset();
-          }
-          else
-          {
-            climate->fan_mode.reset();
-            climate->custom_fan_mode = fanmode_to_custom_climatefanmode(value);
-          }
-          climate->publish_state();
+        auto fanmode = fanmode_to_climatefanmode(value);
+        if (fanmode.has_value())
+        {
+          if (climate->fan_mode == fanmode && !climate->custom_fan_mode.has_value())
+            return false;
+          climate->fan_mode = fanmode;
+          climate->custom_fan_mode.reset();
         }
-      }
-
-      void update_altmode(AltMode value)
-      {
-        if (climate != nullptr)
+        else
         {
-          auto supported = get_supported_alt_modes();
-          auto mode = std::find_if(supported->begin(), supported->end(), [&value](const AltModeDesc &x)
-                                   { return x.value == value; });
-          if (mode == supported->end())
-          {
-            ESP_LOGW(TAG, "Unsupported alt_mode %d", value);
-            return;
-          }
-
-          auto preset = altmodename_to_preset(mode->name);
-          if (preset)
-          {
-            climate->preset = preset.value();
-            climate->custom_preset.reset();
-          }
-          else
-          {
-            climate->preset.reset();
-            climate->custom_preset = mode->name;
-          }
-          climate->publish_state();
+          auto custom_fan_mode = fanmode_to_custom_climatefanmode(value);
+          if (!climate->fan_mode.has_value() && climate->custom_fan_mode == custom_fan_mode)
+            return false;
+          climate->fan_mode.reset();
+          climate->custom_fan_mode = custom_fan_mode;
         }
+        return true;
       }
 
-      void update_swing_vertical(bool value)
+      bool update_altmode(AltMode value)
       {
-        if (climate != nullptr)
+        if (climate == nullptr)
+          return false;
+
+        auto supported = get_supported_alt_modes();
+        auto mode = std::find_if(supported->begin(), supported->end(), [&value](const AltModeDesc &x)
+                                 { return x.value == value; });
+        if (mode == supported->end())
         {
-          climate->swing_mode = combine(climate->swing_mode, 1, value);
-          climate->publish_state();
+          ESP_LOGW(TAG, "Unsupported alt_mode %d", value);
+          return false;
         }
-      }
 
-      void update_swing_horizontal(bool value)
-      {
-        if (climate != nullptr)
+        auto preset = altmodename_to_preset(mode->name);
+        if (preset)
         {
-          climate->swing_mode = combine(climate->swing_mode, 2, value);
-          climate->publish_state();
+          if (climate->preset == preset && !climate->custom_preset.has_value())
+            return false;
+          climate->preset = preset.value();
+          climate->custom_preset.reset();
         }
-      }
-
-      void update_room_temperature(float value)
-      {
-        if (room_temperature != nullptr)
-          room_temperature->publish_state(value + room_temperature_offset);
-        if (climate != nullptr)
+        else
         {
-          climate->current_temperature = value + room_temperature_offset;
-          climate->publish_state();
+          if (!climate->preset.has_value() && climate->custom_preset == mode->name)
+            return false;
+          climate->preset.reset();
+          climate->custom_preset = mode->name;
         }
+        return true;
       }
 
-      void update_outdoor_temperature(float value)
+      bool update_swing_vertical(bool value)
       {
-        if (outdoor_temperature != nullptr)
-          outdoor_temperature->publish_state(value);
+        return update_swing(1, value);
       }
 
-      void update_indoor_eva_in_temperature(float value)
+      bool update_swing_horizontal(bool value)
       {
-        if (indoor_eva_in_temperature != nullptr)
-          indoor_eva_in_temperature->publish_state(value);
+        return update_swing(2, value);
       }
 
-      void update_indoor_eva_out_temperature(float value)
+      bool update_swing(uint8_t mask, bool value)
       {
-        if (indoor_eva_out_temperature != nullptr)
-          indoor_eva_out_temperature->publish_state(value);
+        if (climate == nullptr)
+          return false;
+        auto swing_mode = combine(climate->swing_mode, mask, value);
+        if (climate->swing_mode == swing_mode)
+          return false;
+        climate->swing_mode = swing_mode;
+        return true;
       }
 
-      void update_error_code(int value)
+      bool update_room_temperature(float value)
       {
-        if (error_code != nullptr)
-          error_code->publish_state(value);
+        value += room_temperature_offset;
+        if (room_temperature != nullptr && publish_due(room_temperature_shadow_, value))
+          room_temperature->publish_state(value);
+        if (climate == nullptr || climate->current_temperature == value)
+          return false;
+        climate->current_temperature = value;
+        return true;
       }
 
-      void update_custom_sensor(uint16_t message_number, float value)
-      {
-        for (auto &sensor : custom_sensors)
-          if (sensor.message_number == message_number)
-            sensor.sensor->publish_state(value);
-      }
-
-      void publish_request(ProtocolRequest &request)
+      void update_outdoor_temperature(float value)
       {
-        protocol->publish_request(target, address, request);
+        if (outdoor_temperature != nullptr && publish_due(outdoor_temperature_shadow_, value))
+          outdoor_temperature->publish_state(value);
       }
 
-      bool supports_horizontal_swing()
+      void update_indoor_eva_in_temperature(float value)
       {
-        return supports_horizontal_swing_;
+        if (indoor_eva_in_temperature != nullptr && publish_due(indoor_eva_in_temperature_shadow_, value))
+          indoor_eva_in_temperature->publish_state(value);
       }
 
-      bool supports_vertical_swing()
+      void update_indoor_eva_out_temperature(float value)
       {
-        return supports_vertical_swing_;
+        if (indoor_eva_out_temperature != nullptr && publish_due(indoor_eva_out_temperature_shadow_, value))
+          indoor_eva_out_temperature->publish_state(value);
       }
 
-      void set_supports_horizontal_swing(bool value)
+      void update_error_code(int value)
       {
-        supports_horizontal_swing_ = value;
+        if (error_code != nullptr && publish_due(error_code_shadow_, value))
+          error_code->publish_state(value);
       }
 
-      void set_supports_vertical_swing(bool value)
+      // NASA structure messages (type bits 0b11) carry raw bytes instead of a value
+      static bool is_writable_message(int message_number)
       {
-        supports_vertical_swing_ = value;
+        return ((message_number & 0x600) >> 9) != 3;
       }
 
-      void add_alt_mode(const AltModeName &name, AltMode value)
+      // Bindings are kept sorted at setup, so the entities of a message are found by a binary
+      // search instead of scanning all of them for every message. The decoder only passes on the
+      // messages of this device which have a binding.
+      void add_binding(int message_number, MessageBinding &binding)
       {
-        AltModeDesc desc;
-        desc.name = name;
-        desc.value = value;
-        alt_modes.push_back(std::move(desc));
+        binding.message_number = (uint16_t)message_number;
+        auto it = std::upper_bound(bindings.begin(), bindings.end(), binding.message_number, [](uint16_t number, const MessageBinding &b)
+                                   { return number < b.message_number; });
+        bindings.insert(it, binding);
+        custom_message_subscriptions.add(address, binding.message_number);
       }
 
-      const std::vector<AltModeDesc> *get_supported_alt_modes()
+      void publish_custom_message(uint16_t message_number, long value)
       {
-        return &alt_modes;
+        ProtocolRequest request;
+        request.custom_messages.push_back({message_number, value});
+        publish_request(request);
       }
 
-      void set_room_temperature_offset(float value)
+      void invalidate_custom_shadow(uint16_t message_number)
       {
-        room_temperature_offset = value;
+        auto it = std::lower_bound(bindings.begin(), bindings.end(), message_number, [](const MessageBinding &b, uint16_t number)
+                                   { return b.message_number < number; });
+        for (; it != bindings.end() && it->message_number == message_number; ++it)
+          it->shadow.invalidate();
       }
 
-      void protocol_update(MessageTarget *target)
+      void update_custom_sensor(const CustomSensorValue &custom)
       {
-        if (protocol != nullptr)
+        const float value = custom.value;
+        auto it = std::lower_bound(bindings.begin(), bindings.end(), custom.message_number, [](const MessageBinding &b, uint16_t number)
+                                   { return b.message_number < number; });
+        for (; it != bindings.end() && it->message_number == custom.message_number; ++it)
         {
-          protocol->protocol_update(target);
+          switch (it->kind)
+          {
+          case MessageBinding::Kind::Sensor:
+          {
+            const float sensor_value = it->scaled ? custom.scaled_value : value;
+            if (publish_due(it->shadow, sensor_value))
+              it->sensor->publish_state(sensor_value);
+            break;
+          }
+          case MessageBinding::Kind::Number:
+            if (publish_due(it->shadow, value / it->divisor))
+              it->number->publish_state(value / it->divisor);
+            break;
+          case MessageBinding::Kind::Switch:
+            if (publish_due(it->shadow, value))
+              it->switch_->publish_state(value != 0);
+            break;
+          case MessageBinding::Kind::Select:
+            if (publish_due(it->shadow, value))
+              it->select->publish_value((long)value);
+            break;
+          }
         }
       }
 
-    protected:
-      bool supports_horizontal_swing_{false};
-      bool supports_vertical_swing_{false};
-      std::vector<AltModeDesc> alt_modes;
-
-      Protocol *protocol{nullptr};
-      MessageTarget *target{nullptr};
-
       climate::ClimateSwingMode combine(climate::ClimateSwingMode climateSwingMode, uint8_t mask, bool value)
       {
         uint8_t swingMode = static_cast<uint8_t>(climateswingmode_to_swingmode(climateSwingMode));
         return swingmode_to_climateswingmode(static_cast<SwingMode>(value ? (swingMode | mask) : (swingMode & ~mask)));
       }
 
-      void calc_and_publish_mode()
+      bool calc_mode()
       {
+        if (climate == nullptr)
+          return false;
         if (!_cur_power.has_value())
-          return;
+          return false;
         if (!_cur_mode.has_value())
-          return;
+          return false;
 
-        climate->mode = climate::ClimateMode::CLIMATE_MODE_OFF;
+        auto climate_mode = climate::ClimateMode::CLIMATE_MODE_OFF;
         if (_cur_power.value() == true)
         {
           auto opt = mode_to_climatemode(_cur_mode.value());
           if (opt.has_value())
-            climate->mode = opt.value();
+            climate_mode = opt.value();
         }
-
-        climate->publish_state();
+        if (climate->mode == climate_mode)
+          return false;
+        climate->mode = climate_mode;
+        return true;
       }
     };
   } // namespace samsung_ac
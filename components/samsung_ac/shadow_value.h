@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+namespace esphome
+{
+  namespace samsung_ac
+  {
+    // Last published value of an entity. The units repeat their values every few seconds, so
+    // an entity is only published when its value changed by at least the deadband or when the
+    // heartbeat interval has passed (0 disables the heartbeat). The value is the one which is
+    // published, i.e. after the scaling of the message registry or the divisor of a number.
+    struct ShadowValue
+    {
+      float value = NAN;
+      uint32_t last_publish = 0;
+      float deadband = 0;
+
+      bool should_publish(float new_value, uint32_t now, uint32_t heartbeat)
+      {
+        const bool changed = std::isnan(value) || (new_value != value && std::fabs(new_value - value) >= deadband);
+        if (!changed && (heartbeat == 0 || now - last_publish < heartbeat))
+          return false;
+
+        value = new_value;
+        last_publish = now;
+        return true;
+      }
+
+      // The entity was published with a value which was not reported by the unit (e.g. an
+      // optimistic switch), so the next reported value is published again.
+      void invalidate()
+      {
+        value = NAN;
+      }
+    };
+  } // namespace samsung_ac
+} // namespace esphome
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+
+namespace esphome
+{
+  namespace samsung_ac
+  {
+    template <size_t SLOTS, uint32_t TICK>
+    class TimerWheel;
+
+    // Timer which can be scheduled on a TimerWheel. It is linked into the slot of its deadline, so
+    // scheduling and cancelling is O(1) and no memory is allocated. A timer unlinks itself when it
+    // is destroyed, so it can live inside of objects which are removed at any time. Copies share
+    // the callback but are not scheduled.
+    class WheelTimer
+    {
+    public:
+      WheelTimer() = default;
+      WheelTimer(const WheelTimer &other) : callback(other.callback) {}
+      WheelTimer &operator=(const WheelTimer &other)
+      {
+        cancel();
+        callback = other.callback;
+        return *this;
+      }
+      ~WheelTimer() { cancel(); }
+
+      bool scheduled() const { return prev_ != nullptr; }
+      uint32_t deadline() const { return deadline_; }
+
+      void cancel()
+      {
+        if (prev_ == nullptr)
+          return;
+        *prev_ = next_;
+        if (next_ != nullptr)
+          next_->prev_ = prev_;
+        prev_ = nullptr;
+        next_ = nullptr;
+      }
+
+      std::function<void()> callback;
+
+    protected:
+      template <size_t, uint32_t>
+      friend class TimerWheel;
+
+      void link(WheelTimer **head)
+      {
+        next_ = *head;
+        if (next_ != nullptr)
+          next_->prev_ = &next_;
+        prev_ = head;
+        *head = this;
+      }
+
+      uint32_t deadline_ = 0;
+      WheelTimer *next_ = nullptr;
+      WheelTimer **prev_ = nullptr;
+    };
+
+    // Hashed timer wheel. Each slot holds the timers whose deadline falls into one tick (modulo the
+    // number of slots), so advance() only looks at the slots of the ticks which passed since the last
+    // call. Timers further away than one revolution stay in their slot and are skipped until their
+    // deadline was reached. Every timer fires exactly once per schedule().
+    template <size_t SLOTS, uint32_t TICK>
+    class TimerWheel
+    {
+      static_assert(SLOTS > 0 && (SLOTS & (SLOTS - 1)) == 0, "TimerWheel slots must be a power of two");
+
+    public:
+      TimerWheel() = default;
+      ~TimerWheel() { clear(); }
+
+      // Deadlines which already passed fire on the next advance().
+      void schedule(WheelTimer &timer, uint32_t deadline)
+      {
+        timer.cancel();
+        timer.deadline_ = deadline;
+        uint32_t tick = deadline / TICK;
+        if (started_ && (int32_t)(tick - current_) < 0)
+          tick = current_;
+        timer.link(&slots_[tick & MASK]);
+      }
+
+      void advance(uint32_t now)
+      {
+        const uint32_t target = now / TICK;
+
+        // the current tick is visited again, it may have got new timers since the last call. The
+        // first call visits all slots, timers may have been scheduled before the time was known.
+        uint32_t ticks = target - current_ + 1;
+        if (!started_ || ticks > SLOTS)
+          ticks = SLOTS;
+        else if ((int32_t)(target - current_) < 0)
+          ticks = 1;
+        started_ = true;
+
+        WheelTimer *due = nullptr;
+        for (uint32_t i = 0; i < ticks; i++)
+        {
+          WheelTimer *timer = slots_[(current_ + i) & MASK];
+          while (timer != nullptr)
+          {
+            WheelTimer *next = timer->next_;
+            if ((int32_t)(now - timer->deadline_) >= 0)
+            {
+              timer->cancel();
+              timer->link(&due);
+            }
+            timer = next;
+          }
+        }
+        current_ = target;
+
+        // callbacks may schedule or cancel any timer (and destroy the one which fires)
+        while (due != nullptr)
+        {
+          WheelTimer *timer = due;
+          timer->cancel();
+          auto callback = timer->callback;
+          if (callback)
+            callback();
+        }
+      }
+
+      void clear()
+      {
+        for (auto &slot : slots_)
+        {
+          while (slot != nullptr)
+            slot->cancel();
+        }
+      }
+
+    protected:
+      static constexpr uint32_t MASK = SLOTS - 1;
+
+      WheelTimer *slots_[SLOTS] = {};
+      uint32_t current_ = 0;
+      bool started_ = false;
+    };
+
+    // 64 slots of 50ms, one revolution covers 3.2s
+    typedef TimerWheel<64, 50> ProtocolTimers;
+  } // namespace samsung_ac
+} // namespace esphome
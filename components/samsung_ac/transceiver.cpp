@@ -0,0 +1,203 @@
+#include <algorithm>
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include "transceiver.h"
+#include "util.h"
+
+namespace esphome
+{
+  namespace samsung_ac
+  {
+    bool Transceiver::process_rx(MessageTarget *target)
+    {
+      while (rx_buffer_.unread() > 0)
+      {
+        FrameResult frame = frame_parser_.feed(rx_buffer_.read());
+        if (frame == FrameResult::Incomplete)
+          continue;
+
+        const size_t size = rx_buffer_.read_size();
+        if (frame == FrameResult::Invalid || process_frame(frame, rx_buffer_.linearize(size), target) != DecodeResult::Ok)
+        {
+          resync();
+          continue;
+        }
+
+        if (rescan_size_ > 0)
+          stats_.rx_salvaged_bytes += size;
+        commit_rx(size);
+        return true;
+      }
+      return false;
+    }
+
+    // Drops the start byte of a broken frame and continues with the next start byte inside the
+    // bytes which were already read, so a frame which started within the broken one is not lost.
+    void Transceiver::resync()
+    {
+      frame_parser_.reset();
+      do
+      {
+        if (rx_buffer_.at(0) != 0x55) // preamble
+          stats_.rx_discarded_bytes++;
+        commit_rx(1);
+      } while (rx_buffer_.read_size() > 0 && rx_buffer_.at(0) != 0x32);
+
+      rescan_size_ = rx_buffer_.read_size();
+      rx_buffer_.rewind();
+    }
+
+    void Transceiver::commit_rx(size_t size)
+    {
+      rescan_size_ -= std::min(size, rescan_size_);
+      rx_buffer_.commit(size);
+    }
+
+    void Transceiver::push(std::vector<uint8_t> &data, TxPriority priority)
+    {
+      auto &queue = tx_queues_[(uint8_t)priority];
+      if (queue.size() >= TX_QUEUE_SIZE)
+      {
+        ESP_LOGW(TAG, "TX queue full, dropping %s", bytes_to_hex(queue.front().data).c_str());
+        queue.pop_front();
+        stats_.tx_dropped++;
+      }
+
+      TxFrame frame;
+      frame.data = data;
+      queue.push_back(std::move(frame));
+    }
+
+    const std::vector<uint8_t> *Transceiver::next_tx(uint32_t now, bool bus_busy)
+    {
+      if (tx_echo_pending_ || rx_buffer_.unread() > 0)
+        return nullptr;
+      if (now - last_transmission_ < tx_idle_gap_ || (int32_t)(now - tx_backoff_until_) < 0)
+        return nullptr;
+
+      auto queue = std::find_if(std::begin(tx_queues_), std::end(tx_queues_), [](const std::deque<TxFrame> &queue)
+                                { return !queue.empty(); });
+      if (queue == std::end(tx_queues_))
+        return nullptr;
+
+      // somebody else started to send
+      if (bus_busy || frame_parser_.size() > 0)
+      {
+        stats_.tx_busy_backoffs++;
+        backoff_tx(*queue, now);
+        return nullptr;
+      }
+
+      tx_queue_ = queue - std::begin(tx_queues_);
+      return &queue->front().data;
+    }
+
+    void Transceiver::sent(uint32_t now)
+    {
+      auto &queue = tx_queues_[tx_queue_];
+      last_transmission_ = now;
+
+      // without echo the frame is done, except for the occasional probe whether an echo appeared
+      if (tx_echo_absent_ && (int32_t)(now - tx_echo_probe_at_) < 0)
+      {
+        queue.pop_front();
+        return;
+      }
+
+      // keep the frame until its echo was seen, see match_tx_echo()
+      tx_inflight_ = std::move(queue.front());
+      queue.pop_front();
+      tx_echo_pending_ = true;
+      tx_echo_size_ = 0;
+      tx_echo_deadline_ = now + 20 + tx_inflight_.data.size() * 5; // 5ms per byte covers 2400 baud
+    }
+
+    // Delays the first frame of the queue by a growing backoff (with some jitter so two senders do
+    // not meet again) and drops it after TX_MAX_ATTEMPTS.
+    void Transceiver::backoff_tx(std::deque<TxFrame> &queue, uint32_t now)
+    {
+      TxFrame &frame = queue.front();
+      if (++frame.attempts >= TX_MAX_ATTEMPTS)
+      {
+        ESP_LOGW(TAG, "Giving up, dropping %s", bytes_to_hex(frame.data).c_str());
+        queue.pop_front();
+        stats_.tx_dropped++;
+        return;
+      }
+      const uint32_t backoff = tx_idle_gap_ << std::min<uint8_t>(frame.attempts, 4);
+      tx_backoff_until_ = now + backoff + random_uint32() % (tx_idle_gap_ + 1);
+    }
+
+    // A frame got no echo. Only several misses in a row mean the adapter does not echo, a single
+    // collision or lost echo must not disable the suppression. Once disabled, a frame is checked
+    // for its echo every TX_ECHO_PROBE_INTERVAL ms.
+    void Transceiver::tx_echo_missed(uint32_t now)
+    {
+      tx_echo_probe_at_ = now + TX_ECHO_PROBE_INTERVAL;
+      if (tx_echo_absent_ || ++tx_echo_misses_ < TX_ECHO_MISSES)
+        return;
+
+      ESP_LOGD(TAG, "No TX echo, echo suppression disabled");
+      tx_echo_absent_ = true;
+      tx_echo_seen_ = false;
+    }
+
+    // Half-duplex adapters receive what we send. The received bytes are compared with the frame
+    // which was sent last: an exact echo is dropped before the frame parser sees it, a different
+    // byte means another device sent at the same time, so the frame is sent again. Until an
+    // echo was seen, a frame which differs before our source address (the first 4 bytes are
+    // the same for many frames) or no echo at all counts as missing echo. Returns false while
+    // the echo is still incomplete.
+    bool Transceiver::match_tx_echo(uint32_t now)
+    {
+      while (rx_buffer_.unread() > 0 && tx_echo_size_ < tx_inflight_.data.size())
+      {
+        if (rx_buffer_.read() == tx_inflight_.data[tx_echo_size_])
+        {
+          tx_echo_size_++;
+          continue;
+        }
+
+        rx_buffer_.rewind();
+        tx_echo_pending_ = false;
+        if (!tx_echo_seen_ && tx_echo_size_ <= 3)
+        {
+          tx_echo_missed(now);
+          return true;
+        }
+
+        ESP_LOGW(TAG, "Collision while sending %s", bytes_to_hex(tx_inflight_.data).c_str());
+        tx_echo_seen_ = true;
+        stats_.tx_collisions++;
+        auto &queue = tx_queues_[tx_queue_];
+        queue.push_front(std::move(tx_inflight_));
+        backoff_tx(queue, now);
+        return true;
+      }
+
+      if (tx_echo_size_ == tx_inflight_.data.size())
+      {
+        commit_rx(rx_buffer_.read_size());
+        tx_echo_pending_ = false;
+        tx_echo_seen_ = true;
+        tx_echo_misses_ = 0;
+        stats_.tx_echoes++;
+        if (tx_echo_absent_)
+        {
+          ESP_LOGD(TAG, "TX echo detected, echo suppression enabled");
+          tx_echo_absent_ = false;
+        }
+        return true;
+      }
+
+      if ((int32_t)(now - tx_echo_deadline_) >= 0)
+      {
+        rx_buffer_.rewind();
+        tx_echo_pending_ = false;
+        tx_echo_missed(now);
+        return true;
+      }
+      return false;
+    }
+  } // namespace samsung_ac
+} // namespace esphome
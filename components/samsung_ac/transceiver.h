@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <vector>
+#include "protocol.h"
+#include "ring_buffer.h"
+
+namespace esphome
+{
+  namespace samsung_ac
+  {
+    // The part of the bus handling which does not need the UART: framing of the received bytes,
+    // resynchronization after broken frames, the TX queues and the echo of our own frames.
+    // Samsung_AC copies the bytes between the UART and this class, so all of this runs on the
+    // host in the tests.
+    class Transceiver
+    {
+    public:
+      struct Stats
+      {
+        uint32_t rx_salvaged_bytes = 0;
+        uint32_t rx_discarded_bytes = 0;
+        uint32_t tx_busy_backoffs = 0;
+        uint32_t tx_dropped = 0;
+        uint32_t tx_echoes = 0;
+        uint32_t tx_collisions = 0;
+      };
+
+      // Largest NASA frame is 1500 bytes, the remaining space holds preamble bytes and following frames
+      using Buffer = RingBuffer<2048>;
+
+      Buffer &rx_buffer() { return rx_buffer_; }
+      // Bytes were written to rx_buffer(), the bus is not idle.
+      void received(uint32_t now) { last_transmission_ = now; }
+
+      // Feeds the unread bytes into the frame parser until a frame is complete. Returns true
+      // when a frame was processed.
+      bool process_rx(MessageTarget *target);
+      void resync();
+
+      // a frame was started but no more bytes are left to complete it
+      bool rx_stalled() const { return frame_parser_.size() > 0 && rx_buffer_.unread() == 0; }
+
+      void push(std::vector<uint8_t> &data, TxPriority priority);
+      // Returns the frame which is to be written now, nullptr when nothing is queued or the bus
+      // is not idle. bus_busy tells that the UART holds bytes which were not read yet. Call
+      // sent() once the frame was written.
+      const std::vector<uint8_t> *next_tx(uint32_t now, bool bus_busy);
+      void sent(uint32_t now);
+
+      bool tx_echo_pending() const { return tx_echo_pending_; }
+      bool match_tx_echo(uint32_t now);
+
+      void set_tx_idle_gap(uint32_t value) { tx_idle_gap_ = value; }
+
+      const Stats &stats() const { return stats_; }
+
+      static constexpr size_t TX_QUEUE_SIZE = 16;
+      static constexpr uint8_t TX_MAX_ATTEMPTS = 8;
+      static constexpr uint8_t TX_ECHO_MISSES = 3;
+      static constexpr uint32_t TX_ECHO_PROBE_INTERVAL = 60000;
+
+    protected:
+      void commit_rx(size_t size);
+
+      Buffer rx_buffer_;
+      FrameParser frame_parser_;
+      size_t rescan_size_ = 0;
+      uint32_t last_transmission_ = 0;
+
+      // Frames are only sent after the bus was idle for tx_idle_gap_ ms, so they do not collide
+      // with frames of the units. When the bus turns out to be busy the frame is delayed by a
+      // growing random backoff and dropped after TX_MAX_ATTEMPTS.
+      struct TxFrame
+      {
+        std::vector<uint8_t> data;
+        uint8_t attempts = 0;
+      };
+      void backoff_tx(std::deque<TxFrame> &queue, uint32_t now);
+      void tx_echo_missed(uint32_t now);
+
+      std::deque<TxFrame> tx_queues_[3]; // one for each TxPriority
+      size_t tx_queue_ = 0;              // queue of the frame returned by next_tx() and in flight
+      uint32_t tx_idle_gap_ = 10;
+      uint32_t tx_backoff_until_ = 0;
+
+      // last sent frame, until its echo was received
+      TxFrame tx_inflight_;
+      size_t tx_echo_size_ = 0;
+      uint32_t tx_echo_deadline_ = 0;
+      bool tx_echo_pending_ = false;
+      bool tx_echo_seen_ = false;
+      bool tx_echo_absent_ = false;
+      uint8_t tx_echo_misses_ = 0;
+      uint32_t tx_echo_probe_at_ = 0;
+
+      Stats stats_;
+    };
+  } // namespace samsung_ac
+} // namespace esphome
@@ -16,14 +16,14 @@ namespace esphome
             return (int)strtol(hex.c_str(), NULL, 16);
         }
 
-        std::string bytes_to_hex(const std::vector<uint8_t> &data)
+        std::string bytes_to_hex(ByteSpan data)
         {
             std::string str;
-            str.reserve(data.size() * 2); // Memory reservations are made to increase efficiency.
-            for (uint8_t byte : data)
+            str.reserve(data.size * 2); // Memory reservations are made to increase efficiency.
+            for (size_t i = 0; i < data.size; i++)
             {
                 char buf[3];
-                snprintf(buf, sizeof(buf), "%02x", byte);
+                snprintf(buf, sizeof(buf), "%02x", data[i]);
                 str += buf;
             }
             return str;
@@ -1,8 +1,10 @@
 #pragma once
 
+#include <cstdint>
+#include <cstddef>
+#include <string>
 #include <vector>
 #include <iostream>
-#include <vector>
 #include <bitset>
 #include <optional>
 #include <functional>
@@ -13,9 +15,24 @@ namespace esphome
     {
         static const char *TAG = "samsung_ac";
 
+        // Non-owning view of a contiguous byte sequence (pointer + length).
+        // Used to decode packets without copying them out of the receive buffer.
+        struct ByteSpan
+        {
+            const uint8_t *data = nullptr;
+            size_t size = 0;
+
+            ByteSpan() = default;
+            ByteSpan(const uint8_t *data, size_t size) : data(data), size(size) {}
+            ByteSpan(const std::vector<uint8_t> &data) : data(data.data()), size(data.size()) {}
+
+            uint8_t operator[](size_t index) const { return data[index]; }
+            ByteSpan first(size_t count) const { return ByteSpan(data, count < size ? count : size); }
+        };
+
         std::string long_to_hex(long number);
         int hex_to_int(const std::string &hex);
-        std::string bytes_to_hex(const std::vector<uint8_t> &data);
+        std::string bytes_to_hex(ByteSpan data);
         std::vector<uint8_t> hex_to_bytes(const std::string &hex);
         void print_bits_8(uint8_t value);
     } // namespace samsung_ac
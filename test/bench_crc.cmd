@@ -0,0 +1,2 @@
+@echo ==== BENCHMARK NASA CRC ====
+@"%~dp0%build_and_run.cmd" "-O2 test/main_bench_crc.cpp"
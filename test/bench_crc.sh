@@ -0,0 +1,2 @@
+echo ==== BENCHMARK NASA CRC ====
+./test/build_and_run.sh "-O2 test/main_bench_crc.cpp"
@@ -1,3 +1,3 @@
-g++ $1 components/samsung_ac/protocol.cpp components/samsung_ac/protocol_nasa.cpp components/samsung_ac/protocol_non_nasa.cpp components/samsung_ac/util.cpp components/samsung_ac/debug_mqtt.cpp -Itest -o test.exe
+g++ $1 components/samsung_ac/protocol.cpp components/samsung_ac/protocol_nasa.cpp components/samsung_ac/protocol_non_nasa.cpp components/samsung_ac/util.cpp components/samsung_ac/debug_mqtt.cpp components/samsung_ac/transceiver.cpp -Itest -o test.exe
 chmod +x test.exe
 ./test.exe
@@ -0,0 +1,9 @@
+#pragma once
+// Fake Helpers for Local Testing
+
+#include <cstdint>
+
+namespace esphome
+{
+    uint32_t random_uint32();
+} // namespace esphome
@@ -0,0 +1,60 @@
+#include "test_stuff.h"
+#include "../components/samsung_ac/protocol_nasa.h"
+#include <chrono>
+#include <cstdlib>
+
+using namespace std;
+using namespace esphome::samsung_ac;
+
+// the bitwise implementation which was used before the lookup tables
+uint16_t crc16_bitwise(ByteSpan data, int startIndex, int length)
+{
+    uint16_t crc = 0;
+    for (int index = startIndex; index < startIndex + length; ++index)
+    {
+        crc = crc ^ ((uint16_t)((uint8_t)data[index]) << 8);
+        for (uint8_t i = 0; i < 8; i++)
+        {
+            if (crc & 0x8000)
+                crc = (crc << 1) ^ 0x1021;
+            else
+                crc <<= 1;
+        }
+    }
+    return crc;
+}
+
+template <typename F>
+void bench(const char *name, const std::vector<uint8_t> &data, int iterations, F crc)
+{
+    volatile uint16_t sink = 0;
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+        sink = sink ^ crc(data, 3, data.size() - 6);
+    auto ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+    cout << name << ": " << (double)ns / iterations << " ns/packet, "
+         << (double)ns / iterations / (data.size() - 6) << " ns/byte" << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    // typical packet sizes seen on the bus, from a single message up to a large outdoor notification
+    for (size_t size : {20, 64, 256, 1500})
+    {
+        std::vector<uint8_t> data(size);
+        for (auto &c : data)
+            c = rand() & 0xff;
+
+        assert(crc16(data, 3, size - 6) == crc16_bitwise(data, 3, size - 6));
+
+        uint16_t crc = 0;
+        for (size_t i = 3; i < size - 3; i++)
+            crc = crc16_update(crc, data[i]);
+        assert(crc == crc16_bitwise(data, 3, size - 6));
+
+        const int iterations = 20000000 / size;
+        cout << "==== " << size << " bytes ====" << endl;
+        bench("bitwise", data, iterations, crc16_bitwise);
+        bench("table  ", data, iterations, crc16);
+    }
+}
@@ -7,12 +7,13 @@ using namespace esphome::samsung_ac;
 
 int main(int argc, char *argv[])
 {
-    debug_log_packets = true;
+    debug_log_raw_bytes = true;
 
     std::ifstream file("test.txt");
     std::string str((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
 
     DebugTarget target;
+    FrameParser parser;
     std::vector<uint8_t> data_;
     for (int i = 0; i < str.size(); i += 2)
     {
@@ -23,10 +24,12 @@ int main(int argc, char *argv[])
 
         data_.push_back(c);
 
-        if (process_data(data_, &target) == DataResult::Clear)
-        {
-            data_.clear();
-            continue; // wait for next loop
-        }
+        FrameResult frame = parser.feed(c);
+        if (frame == FrameResult::Incomplete)
+            continue;
+
+        if (frame != FrameResult::Invalid)
+            process_frame(frame, ByteSpan(data_.data(), data_.size()), &target);
+        data_.clear();
     }
 };
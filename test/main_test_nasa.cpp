@@ -1,5 +1,8 @@
 #include "test_stuff.h"
 #include "../components/samsung_ac/protocol_nasa.h"
+#include "../components/samsung_ac/ring_buffer.h"
+#include "../components/samsung_ac/transceiver.h"
+#include "../components/samsung_ac/shadow_value.h"
 
 using namespace std;
 using namespace esphome::samsung_ac;
@@ -38,13 +41,722 @@ void test_nasa_2()
     std::cout << "32001280ff00200002c013f201420101186e5434 expected" << std::endl;
 }
 
+void test_decode_corrupt_capacity()
+{
+    Packet packet = Packet::create(Address::parse("20.00.00"), DataType::Request, MessageNumber::ENUM_in_operation_power, 1);
+    auto data = packet.encode();
+
+    // claim 200 messages but keep the crc valid, decoding must stop at the end of the packet
+    data[12] = 200;
+    uint16_t crc = crc16(data, 3, data.size() - 6);
+    data[data.size() - 3] = (uint8_t)(crc >> 8);
+    data[data.size() - 2] = (uint8_t)(crc & 0xff);
+
+    Packet decoded;
+    assert(decoded.decode(ByteSpan(data.data(), data.size())) == DecodeResult::UnexpectedSize);
+}
+
 void test_process_data()
 {
+    // bytes arrive one by one, the frame is only complete with the end byte
+    DebugTarget target;
+    auto bytes = hex_to_bytes("32001280ff00200002c013f201420101186e5434");
+    FrameParser parser;
+    for (size_t i = 0; i + 1 < bytes.size(); i++)
+        assert(parser.feed(bytes[i]) == FrameResult::Incomplete);
+    assert(parser.feed(bytes.back()) == FrameResult::Nasa);
+    assert(parser.size() == 0);
+    assert(process_frame(FrameResult::Nasa, ByteSpan(bytes.data(), bytes.size()), &target) == DecodeResult::Ok);
+    assert(target.last_register_address == "80.ff.00");
+
+    // a size field out of range is dropped as soon as it is known
+    assert(parser.feed(0x32) == FrameResult::Incomplete);
+    assert(parser.feed(0xff) == FrameResult::Incomplete);
+    assert(parser.feed(0xff) == FrameResult::Invalid);
+    assert(parser.size() == 0);
+}
+
+void test_crc16()
+{
+    auto bytes = hex_to_bytes("32001280ff00200002c013f201420101186e5434");
+    assert(crc16(bytes, 3, bytes.size() - 6) == 0x6e54);
+
+    // slice-by-4 and the byte wise update have to agree for every remainder
+    for (int length = 0; length <= 14; length++)
+    {
+        uint16_t crc = 0;
+        for (int i = 3; i < 3 + length; i++)
+            crc = crc16_update(crc, bytes[i]);
+        assert(crc16(bytes, 3, length) == crc);
+    }
+
+    // the frame parser checks the crc while the bytes arrive
+    FrameParser parser;
+    for (size_t i = 0; i + 1 < bytes.size(); i++)
+        assert(parser.feed(bytes[i]) == FrameResult::Incomplete);
+    assert(parser.feed(bytes.back()) == FrameResult::Nasa);
+
+    bytes[10] ^= 0x01;
+    for (size_t i = 0; i + 1 < bytes.size(); i++)
+        parser.feed(bytes[i]);
+    assert(parser.feed(bytes.back()) == FrameResult::NasaCrcError);
+    assert(process_frame(FrameResult::NasaCrcError, bytes, nullptr) == DecodeResult::CrcError);
+}
+
+void test_messageset_size()
+{
+    // scalar value or structure view, but never a copy of the payload
+    assert(sizeof(MessageSet) <= 8 + 2 * sizeof(void *));
+
+    Packet packet = Packet::create(Address::parse("20.00.00"), DataType::Request, MessageNumber::VAR_in_temp_target_f, 240);
+    auto data = packet.encode();
+    Packet decoded;
+    assert(decoded.decode(data) == DecodeResult::Ok);
+    assert(decoded.messages.size() == 1);
+    assert(decoded.messages[0].value == 240);
+}
+
+void test_long_variable()
+{
+    MessageSet set((MessageNumber)0x8413);
+    assert(set.type == MessageSetType::LongVariable);
+    set.value = 0x01020304;
+    std::vector<uint8_t> data;
+    set.encode(data);
+    assert_str(bytes_to_hex(data), "841301020304");
+
+    auto decoded = MessageSet::decode(data, 0);
+    assert(decoded.value == 0x01020304);
+
+    // structure messages cannot be written
+    DebugTarget target;
+    ProtocolRequest request;
+    request.custom_messages.push_back({(uint16_t)MessageNumber::STR_out_install_inverter_and_bootloader_info, 1});
+    get_protocol(DeviceAddress::parse("20.00.00"))->publish_request(&target, DeviceAddress::parse("20.00.00"), request);
+    assert(target.last_publish_data.empty());
+}
+
+void test_decode_structure()
+{
+    const std::vector<uint8_t> info = {'V', '1', '.', '2', '3', 0, 0x01, 0x02};
+
+    Packet packet = Packet::createa_partial(Address::parse("20.00.00"), DataType::Notification);
+    MessageSet power(MessageNumber::ENUM_in_operation_power);
+    power.value = 1;
+    packet.messages.push_back(power);
+    MessageSet str(MessageNumber::STR_out_install_inverter_and_bootloader_info);
+    str.structure.data = info.data();
+    str.structure.size = info.size();
+    packet.messages.push_back(str);
+    auto data = packet.encode();
+
+    Packet decoded;
+    assert(decoded.decode(data) == DecodeResult::Ok);
+    assert(decoded.messages.size() == 2);
+    assert(decoded.messages[0].value == 1);
+    auto &set = decoded.messages[1];
+    assert(set.type == MessageSetType::Structure);
+    assert(set.structure.size == info.size());
+    assert(set.structure.data == data.data() + 18); // view into the frame, no copy
+    assert_str(set.get_inverter_and_bootloader_info(), "V1.23");
+    assert_str(set.structure_hex(), "56312e3233000102");
+    assert_str(set.get_dbcode_micom_main(), "");
+
+    // a structure in front of another message can not be decoded
+    std::swap(packet.messages[0], packet.messages[1]);
+    data = packet.encode();
+    assert(decoded.decode(data) == DecodeResult::UnexpectedSize);
+}
+
+void test_message_registry()
+{
+    auto info = find_message_info(MessageNumber::VAR_out_sensor_airout);
+    assert(info != nullptr);
+    assert_str(info->name, "VAR_out_sensor_airout");
+    assert(info->type() == MessageSetType::Variable);
+    assert(info->to_value(0xfff6) == -1.0);
+    assert(find_message_info(MessageNumber::ENUM_in_operation_power)->to_value(1) == 1.0);
+    assert(find_message_info((MessageNumber)0x1234) == nullptr);
+
+    // the handler of the registry entry is dispatched, the test packets are sent from our address
+    const DeviceAddress source = Address::get_my_address().packed();
+    custom_message_subscriptions.add(source, 0x8204);
+    DebugTarget target;
+    Packet packet = Packet::create(Address::parse("20.00.00"), DataType::Notification, MessageNumber::VAR_out_sensor_airout, 0xfff6);
+    auto data = packet.encode();
+    assert(process_frame(FrameResult::Nasa, data, &target) == DecodeResult::Ok);
+    assert(target.last_set_outdoor_temperature_value == -1.0f);
+    assert(target.last_custom_sensors.count(0x8204) == 1);
+
+    // all messages of a packet are applied with a single call
+    packet = Packet::create(Address::parse("20.00.00"), DataType::Notification, MessageNumber::ENUM_in_operation_power, 1);
+    MessageSet mode(MessageNumber::ENUM_in_operation_mode);
+    mode.value = 1;
+    packet.messages.push_back(mode);
+    data = packet.encode();
+    assert(process_frame(FrameResult::Nasa, data, &target) == DecodeResult::Ok);
+    assert(target.set_state_calls == 2);
+    assert(target.last_set_power_value == true);
+    assert(target.last_set_mode_mode == Mode::Cool);
+
+    // custom sensors carry the raw and the scaled value
+    custom_message_subscriptions.add(source, 0x4237);
+    packet = Packet::create(Address::parse("20.00.00"), DataType::Notification, MessageNumber::VAR_in_temp_water_tank_f, 0xfff6);
+    data = packet.encode();
+    assert(process_frame(FrameResult::Nasa, data, &target) == DecodeResult::Ok);
+    assert(target.last_custom_sensor.message_number == 0x4237);
+    assert(target.last_custom_sensor.value == 0xfff6);
+    assert(target.last_custom_sensor.scaled_value == -1.0f);
+}
+
+void test_shadow_value()
+{
+    // the deadband applies to the published value, for a message sensor that is the value
+    // scaled by the registry
+    ShadowValue shadow;
+    shadow.deadband = 0.5f;
+    custom_message_subscriptions.clear();
+    custom_message_subscriptions.add(Address::get_my_address().packed(), 0x4237);
+    DebugTarget target;
+    auto publish_due = [&](long raw, uint32_t now)
+    {
+        Packet packet = Packet::create(Address::parse("20.00.00"), DataType::Notification, MessageNumber::VAR_in_temp_water_tank_f, raw);
+        auto data = packet.encode();
+        assert(process_frame(FrameResult::Nasa, data, &target) == DecodeResult::Ok);
+        return shadow.should_publish(target.last_custom_sensor.scaled_value, now, 300000);
+    };
+    assert(publish_due(250, 0));
+    assert(!publish_due(254, 1000));
+    assert(publish_due(255, 2000));
+    assert(shadow.value == 25.5f);
+    assert(!publish_due(251, 3000));
+
+    // unchanged values are published again on the heartbeat
+    assert(!publish_due(255, 301999));
+    assert(publish_due(255, 302000));
+
+    // an invalidated value is published even when it did not change
+    shadow.invalidate();
+    assert(publish_due(255, 302001));
+    custom_message_subscriptions.clear();
+}
+
+void test_message_subscriptions()
+{
+    const DeviceAddress indoor1 = DeviceAddress::parse("20.00.00");
+    const DeviceAddress indoor2 = DeviceAddress::parse("20.00.01");
+    MessageSubscriptions subscriptions;
+    subscriptions.add(indoor1, 0x4237);
+    subscriptions.add(indoor1, 0x4038);
+    subscriptions.add(indoor1, 0x4237);
+    subscriptions.add(indoor2, 0x4038);
+    assert(subscriptions.size() == 3);
+    assert(subscriptions.contains(indoor1, 0x4237));
+    assert(subscriptions.contains(indoor1, 0x4038));
+    assert(subscriptions.contains(indoor2, 0x4038));
+    assert(!subscriptions.contains(indoor2, 0x4237));
+    assert(!subscriptions.contains(indoor1, 0x4236));
+    assert(!subscriptions.contains(indoor1, 0x8204));
+
+    // only messages subscribed for the sending device are passed on as custom values
+    custom_message_subscriptions.clear();
+    custom_message_subscriptions.add(indoor1, 0x4238);
+    custom_message_subscriptions.add(indoor2, 0x4239);
+    DebugTarget target;
+    Packet packet = Packet::create(Address::parse("b0.ff.20"), DataType::Notification, (MessageNumber)0x4238, 12);
+    packet.sa = Address::parse("20.00.00");
+    MessageSet other((MessageNumber)0x4239);
+    other.value = 13;
+    packet.messages.push_back(other);
+    auto data = packet.encode();
+    assert(process_frame(FrameResult::Nasa, data, &target) == DecodeResult::Ok);
+    assert(target.last_custom_sensors.count(0x4238) == 1);
+    assert(target.last_custom_sensors.count(0x4239) == 0);
+    custom_message_subscriptions.clear();
+}
+
+Packet reply_to(const Packet &request, DataType dataType)
+{
+    Packet reply;
+    reply.sa = request.da;
+    reply.da = request.sa;
+    reply.command.dataType = dataType;
+    reply.command.packetNumber = request.command.packetNumber;
+    return reply;
+}
+
+void test_nasa_transactions()
+{
+    nasa_transactions.clear();
+    DebugTarget target;
+    target.now = 1000;
+
+    ProtocolRequest request;
+    request.power = true;
+    NasaProtocol protocol;
+    protocol.publish_request(&target, DeviceAddress::parse("20.00.00"), request);
+    assert(nasa_transactions.size() == 1);
+
+    Packet sent;
+    auto sent_data = hex_to_bytes(target.last_publish_data);
+    assert(sent.decode(sent_data) == DecodeResult::Ok);
+
+    // an ack from another unit with the same packet number does not match
+    Packet other = reply_to(sent, DataType::Ack);
+    other.sa = Address::parse("20.00.01");
+    auto data = other.encode();
+    target.now = 1100;
+    assert(process_frame(FrameResult::Nasa, data, &target) == DecodeResult::Ok);
+    assert(nasa_transactions.size() == 1);
+
+    // neither does an ack of the unit to another node (e.g. a wired remote)
+    other = reply_to(sent, DataType::Ack);
+    other.da = Address::parse("50.00.00");
+    data = other.encode();
+    assert(process_frame(FrameResult::Nasa, data, &target) == DecodeResult::Ok);
+    assert(nasa_transactions.size() == 1);
+
+    // no reply in time, the request is sent again with the retry count set
+    target.last_publish_data.clear();
+    target.now = 1000 + NasaTransactionTable::TIMEOUT;
+    target.timers.advance(target.now);
+    assert(nasa_transactions.stats().retries == 1);
+    sent_data = hex_to_bytes(target.last_publish_data);
+    assert(sent.decode(sent_data) == DecodeResult::Ok);
+    assert(sent.command.retryCount == 1);
+
+    data = reply_to(sent, DataType::Ack).encode();
+    target.now = 1000 + NasaTransactionTable::TIMEOUT + 120;
+    assert(process_frame(FrameResult::Nasa, data, &target) == DecodeResult::Ok);
+    assert(nasa_transactions.size() == 0);
+    assert(nasa_transactions.stats().completed == 1);
+    assert(nasa_transactions.stats().last_rtt == 120);
+
+    // requests without reply expire after the last retry
+    protocol.publish_request(&target, DeviceAddress::parse("20.00.00"), request);
+    for (int i = 0; i <= NasaTransactionTable::MAX_RETRIES; i++)
+    {
+        target.now += NasaTransactionTable::TIMEOUT;
+        target.timers.advance(target.now);
+    }
+    assert(nasa_transactions.size() == 0);
+    assert(nasa_transactions.stats().expired == 1);
+
+    // the table never grows beyond its capacity
+    for (int i = 0; i < NasaTransactionTable::CAPACITY + 3; i++)
+        protocol.publish_request(&target, DeviceAddress::parse("20.00.00"), request);
+    assert(nasa_transactions.size() == NasaTransactionTable::CAPACITY);
+    nasa_transactions.clear();
+}
+
+void test_poll_scheduler()
+{
+    nasa_transactions.clear();
+    nasa_poll_scheduler.clear();
+    DebugTarget target;
+    target.now = 1000;
+
+    nasa_poll_scheduler.add(DeviceAddress::parse("20.00.00"), 0x4260, 10000, 0);
+    nasa_poll_scheduler.add(DeviceAddress::parse("20.00.01"), 0x4201, 10000, 0);
+    nasa_poll_scheduler.add(DeviceAddress::parse("20.00.00"), 0x8413, 5000, 1);
+
+    // the due messages of one device are read with a single packet, highest priority first
+    assert(nasa_poll_scheduler.update(&target, target.now));
+    Packet sent;
+    auto data = hex_to_bytes(target.last_publish_data);
+    assert(sent.decode(data) == DecodeResult::Ok);
+    assert(sent.command.dataType == DataType::Read);
+    assert_str(sent.da.to_string(), "20.00.00");
+    assert(sent.messages.size() == 2);
+    assert(sent.messages[0].messageNumber == (MessageNumber)0x8413);
+    assert(sent.messages[1].messageNumber == (MessageNumber)0x4260);
+
+    assert(nasa_poll_scheduler.update(&target, target.now));
+    data = hex_to_bytes(target.last_publish_data);
+    assert(sent.decode(data) == DecodeResult::Ok);
+    assert_str(sent.da.to_string(), "20.00.01");
+    assert(!nasa_poll_scheduler.update(&target, target.now));
+
+    // only the message with the shorter interval is due again
+    assert(nasa_poll_scheduler.update(&target, target.now + 5000));
+    data = hex_to_bytes(target.last_publish_data);
+    assert(sent.decode(data) == DecodeResult::Ok);
+    assert(sent.messages.size() == 1);
+
+    // the response is applied like a notification
+    Packet response = Packet::create(Address::parse("b0.ff.20"), DataType::Response, MessageNumber::VAR_in_temp_target_f, 215);
+    response.sa = Address::parse("20.00.01");
+    data = response.encode();
+    const int calls = target.set_state_calls;
+    assert(process_frame(FrameResult::Nasa, data, &target) == DecodeResult::Ok);
+    assert(target.set_state_calls == calls + 1);
+    assert(target.last_set_target_temperature_value == 21.5f);
+
+    nasa_poll_scheduler.clear();
+    nasa_transactions.clear();
+}
+
+void test_sequence_tracker()
+{
+    nasa_sequence_tracker.clear();
+    auto source = DeviceAddress::parse("20.00.00");
+    assert(nasa_sequence_tracker.track(source, 10, 0, 0));
+    assert(nasa_sequence_tracker.track(source, 11, 0, 0));
+    assert(!nasa_sequence_tracker.track(source, 11, 1, 0)); // retransmission
+    assert(nasa_sequence_tracker.track(source, 14, 0, 0));  // 12 and 13 got lost
+    assert(nasa_sequence_tracker.track(DeviceAddress::parse("10.00.00"), 14, 0, 0));
+    assert(nasa_sequence_tracker.track(source, 0x80, 0, 0)); // restart, no gap
+    assert(nasa_sequence_tracker.track(source, 0x80, 0, 0)); // no retry, the number wrapped around
+    assert(nasa_sequence_tracker.track(source, 0x82, 1, 0)); // retry of a packet we did not see
+    assert(nasa_sequence_tracker.stats().received == 8);
+    assert(nasa_sequence_tracker.stats().duplicates == 1);
+    assert(nasa_sequence_tracker.stats().missing == 3);
+
+    // retransmitted notifications are not applied again
+    DebugTarget target;
+    Packet packet = Packet::create(Address::parse("b0.ff.20"), DataType::Notification, MessageNumber::ENUM_in_operation_power, 1);
+    packet.sa = Address::parse("20.00.05");
+    auto data = packet.encode();
+    assert(process_frame(FrameResult::Nasa, data, &target) == DecodeResult::Ok);
+    packet.command.retryCount = 1;
+    data = packet.encode();
+    assert(process_frame(FrameResult::Nasa, data, &target) == DecodeResult::Ok);
+    assert(target.set_state_calls == 1);
+    nasa_sequence_tracker.clear();
+}
+
+void test_merge_request()
+{
+    ProtocolRequest request;
+    request.target_temp = 21;
+    request.custom_messages.push_back({0x4247, 300});
+
+    ProtocolRequest other;
+    other.target_temp = 22;
+    other.mode = Mode::Heat;
+    other.custom_messages.push_back({0x4247, 310});
+    other.custom_messages.push_back({0x4065, 1});
+    request.merge(other);
+
+    assert(request.target_temp.value() == 22);
+    assert(request.mode.value() == Mode::Heat);
+    assert(!request.power);
+    assert(request.custom_messages.size() == 2);
+    assert(request.custom_messages[0].value == 310);
+}
+
+void test_device_address()
+{
+    auto address = DeviceAddress::parse("20.00.01");
+    assert(address.is_nasa());
+    assert(address == Address::parse("20.00.01").packed());
+    assert(address.klass() == 0x20 && address.channel() == 0x00 && address.address() == 0x01);
+    assert_str(address.to_string(), "20.00.01");
+    assert(get_address_type(address) == AddressType::Indoor);
+    assert(get_address_type(DeviceAddress::parse("10.00.00")) == AddressType::Outdoor);
+
+    auto non_nasa = DeviceAddress::parse("c8");
+    assert(!non_nasa.is_nasa());
+    assert(non_nasa == DeviceAddress::non_nasa(0xc8));
+    assert_str(non_nasa.to_string(), "c8");
+    assert(get_address_type(non_nasa) == AddressType::Outdoor);
+    assert(get_address_type(DeviceAddress::parse("01")) == AddressType::Indoor);
+}
+
+void test_timer_wheel()
+{
+    ProtocolTimers timers;
+    int fired = 0;
+    WheelTimer early, late, cancelled;
+    early.callback = [&fired]()
+    { fired += 1; };
+    late.callback = [&fired]()
+    { fired += 10; };
+    cancelled.callback = [&fired]()
+    { fired += 100; };
+    timers.schedule(early, 120);
+    timers.schedule(late, 5000); // more than one revolution away
+    timers.schedule(cancelled, 200);
+    cancelled.cancel();
+
+    timers.advance(100);
+    assert(fired == 0);
+    timers.advance(150);
+    assert(fired == 1 && !early.scheduled());
+    timers.advance(1800); // same slot as the late timer, but one revolution too early
+    assert(fired == 1 && late.scheduled());
+    timers.advance(5000);
+    assert(fired == 11);
+
+    // deadlines in the past fire on the next advance, and only once
+    timers.schedule(early, 10);
+    timers.advance(5001);
+    timers.advance(5100);
+    assert(fired == 12);
+}
+
+void test_ring_buffer()
+{
+    RingBuffer<8> buffer;
+    for (uint8_t c = 1; c <= 6; c++)
+        assert(buffer.push(c));
+
+    // a processed frame is committed, its space is free again
+    assert(buffer.read() == 1 && buffer.read() == 2);
+    buffer.commit(2);
+    assert(buffer.size() == 4 && buffer.unread() == 4 && buffer.read_size() == 0);
+
+    // rewind reads the uncommitted bytes again
+    assert(buffer.read() == 3 && buffer.read() == 4);
+    assert(buffer.read_size() == 2 && buffer.unread() == 2);
+    buffer.rewind();
+    assert(buffer.read_size() == 0 && buffer.unread() == 4);
+    assert(buffer.read() == 3);
+
+    // bulk writes stop at the end of the storage, the rest continues at its start
+    assert(buffer.write_size() == 2);
+    buffer.write_ptr()[0] = 7;
+    buffer.write_ptr()[1] = 8;
+    buffer.produce(2);
+    assert(buffer.write_size() == 2);
+    assert(buffer.push(9) && buffer.push(10));
+    assert(buffer.free() == 0 && !buffer.push(11));
+    buffer.produce(1); // no space left, ignored
+    assert(buffer.size() == 8 && buffer.at(7) == 10);
+
+    // the frame 3..10 wraps the end of the storage and is rotated into one piece
+    ByteSpan frame = buffer.linearize(8);
+    assert_str(bytes_to_hex(frame), "030405060708090a");
+    assert(buffer.size() == 8 && buffer.read_size() == 1 && buffer.unread() == 7);
+    assert(buffer.at(0) == 3 && buffer.read() == 4);
+
+    // committing past the read cursor moves it along
+    buffer.commit(5);
+    assert(buffer.size() == 3 && buffer.read_size() == 0 && buffer.read() == 8);
+
+    // a view which does not wrap is returned in place
+    buffer.commit(1);
+    assert(buffer.push(11) && buffer.push(12));
+    assert_str(bytes_to_hex(buffer.linearize(10)), "090a0b0c");
+
+    buffer.clear();
+    assert(buffer.size() == 0 && buffer.unread() == 0 && buffer.free() == 8);
+}
+
+void test_transceiver_resync()
+{
+    DebugTarget target;
+    Transceiver transceiver;
+    auto &buffer = transceiver.rx_buffer();
+
+    // preamble, a stray byte, a frame which broke off after 6 bytes and a complete frame
+    for (uint8_t c : hex_to_bytes("555500" "32001280ff00" "32001280ff00200002c013f201420101186e5434"))
+        buffer.push(c);
+
+    // the broken frame fails its crc, the complete frame starts within it and is found again
+    assert(transceiver.process_rx(&target));
+    assert(target.last_register_address == "80.ff.00");
+    assert(!transceiver.process_rx(&target));
+    assert(buffer.size() == 0);
+    assert(transceiver.stats().rx_discarded_bytes == 7); // the preamble is not counted
+    assert(transceiver.stats().rx_salvaged_bytes == 20);
+
+    // a frame which never completes is dropped once the bus went quiet
+    for (uint8_t c : hex_to_bytes("32001280"))
+        buffer.push(c);
+    assert(!transceiver.process_rx(&target));
+    assert(transceiver.rx_stalled());
+    transceiver.resync();
+    assert(!transceiver.rx_stalled() && buffer.size() == 0);
+    assert(transceiver.stats().rx_discarded_bytes == 11);
+}
+
+void test_transceiver_tx()
+{
+    Transceiver transceiver;
+    auto &buffer = transceiver.rx_buffer();
+    std::vector<uint8_t> control = {0x01}, poll = {0x02}, keepalive = {0x03};
+    transceiver.push(keepalive, TxPriority::Keepalive);
+    transceiver.push(poll, TxPriority::Poll);
+    transceiver.push(control, TxPriority::Control);
+
+    // frames are only sent after the bus was idle for the gap, the highest priority first
+    transceiver.received(100);
+    assert(transceiver.next_tx(109, false) == nullptr);
+    const std::vector<uint8_t> *frame = transceiver.next_tx(110, false);
+    assert(frame != nullptr && *frame == control);
+    transceiver.sent(110);
+
+    // nothing is sent until the echo of the last frame arrived
+    assert(transceiver.next_tx(200, false) == nullptr);
+    buffer.push(0x01);
+    transceiver.received(111);
+    assert(transceiver.match_tx_echo(111));
+    assert(!transceiver.tx_echo_pending() && buffer.size() == 0);
+
+    // unread bytes in the UART delay the frame by twice the gap (the jitter is 0 in the tests)
+    assert(transceiver.next_tx(121, true) == nullptr);
+    assert(transceiver.stats().tx_busy_backoffs == 1);
+    assert(transceiver.next_tx(140, false) == nullptr);
+    frame = transceiver.next_tx(141, false);
+    assert(frame != nullptr && *frame == poll);
+    transceiver.sent(141);
+    buffer.push(0x02);
+    transceiver.received(141);
+    assert(transceiver.match_tx_echo(141));
+
+    // a frame of another device is still incomplete
+    buffer.push(0x32);
+    transceiver.received(145);
+    assert(transceiver.next_tx(160, false) == nullptr); // not parsed yet
+    assert(transceiver.stats().tx_busy_backoffs == 1);
+    assert(!transceiver.process_rx(nullptr));
+    assert(transceiver.next_tx(160, false) == nullptr);
+    assert(transceiver.stats().tx_busy_backoffs == 2);
+    transceiver.resync();
+    frame = transceiver.next_tx(180, false);
+    assert(frame != nullptr && *frame == keepalive);
+    transceiver.sent(180);
+    buffer.push(0x03);
+    transceiver.received(180);
+    assert(transceiver.match_tx_echo(180));
+    assert(transceiver.stats().tx_echoes == 3);
+
+    // a frame which never finds the bus idle is dropped
+    transceiver.push(poll, TxPriority::Poll);
+    uint32_t now = 1000;
+    for (uint8_t attempt = 1; attempt <= Transceiver::TX_MAX_ATTEMPTS; attempt++, now += 1000)
+    {
+        assert(transceiver.next_tx(now, true) == nullptr);
+        assert(transceiver.stats().tx_dropped == (attempt == Transceiver::TX_MAX_ATTEMPTS ? 1 : 0));
+    }
+    assert(transceiver.next_tx(now, false) == nullptr);
+
+    // a full queue drops its oldest frame
+    for (uint8_t i = 0; i <= Transceiver::TX_QUEUE_SIZE; i++)
+    {
+        std::vector<uint8_t> data = {i};
+        transceiver.push(data, TxPriority::Poll);
+    }
+    assert(transceiver.stats().tx_dropped == 2);
+    frame = transceiver.next_tx(now, false);
+    assert(frame != nullptr && *frame == std::vector<uint8_t>{0x01});
+}
+
+void test_transceiver_echo()
+{
+    Transceiver transceiver;
+    auto &buffer = transceiver.rx_buffer();
+    const std::string echo = "32000e80ff00200002c0130034";
+    std::vector<uint8_t> data = hex_to_bytes(echo);
+    const uint32_t echo_timeout = 20 + data.size() * 5;
+    uint32_t now = 0;
+    auto send = [&]()
+    {
+        now += 100;
+        transceiver.push(data, TxPriority::Control);
+        assert(transceiver.next_tx(now, false) != nullptr);
+        transceiver.sent(now);
+    };
+    auto receive = [&](const std::string &hex)
+    {
+        for (uint8_t c : hex_to_bytes(hex))
+            buffer.push(c);
+        transceiver.received(now);
+    };
+
+    // the echo is dropped, the reply behind it is left for the frame parser
+    send();
+    receive("32000e80ff0020");
+    assert(!transceiver.match_tx_echo(now));
+    receive("0002c013003432");
+    assert(transceiver.match_tx_echo(now));
+    assert(!transceiver.tx_echo_pending() && buffer.size() == 1 && buffer.unread() == 1);
+    assert(transceiver.stats().tx_echoes == 1);
+    buffer.clear();
+
+    // another device sent at the same time, the frame is sent again after the backoff
+    send();
+    receive("32000e80ff00200102");
+    assert(transceiver.match_tx_echo(now));
+    assert(transceiver.stats().tx_collisions == 1);
+    assert(buffer.unread() == 9);
+    buffer.clear();
+    assert(transceiver.next_tx(now + 19, false) == nullptr);
+    const std::vector<uint8_t> *frame = transceiver.next_tx(now + 20, false);
+    assert(frame != nullptr && *frame == data);
+    now += 20;
+    transceiver.sent(now);
+    receive(echo);
+    assert(transceiver.match_tx_echo(now));
+    assert(transceiver.stats().tx_echoes == 2);
+
+    // a single lost echo does not disable the suppression
+    send();
+    assert(!transceiver.match_tx_echo(now + echo_timeout - 1));
+    assert(transceiver.match_tx_echo(now + echo_timeout));
+    send();
+    assert(transceiver.tx_echo_pending());
+    receive(echo);
+    assert(transceiver.match_tx_echo(now));
+
+    // three in a row do, a frame is done once it was written
+    uint32_t missed_at = 0;
+    for (uint8_t miss = 0; miss < Transceiver::TX_ECHO_MISSES; miss++)
+    {
+        send();
+        assert(transceiver.tx_echo_pending());
+        missed_at = now + echo_timeout;
+        assert(transceiver.match_tx_echo(missed_at));
+    }
+    send();
+    assert(!transceiver.tx_echo_pending());
+
+    // once a minute a frame is checked for its echo again
+    now = missed_at + Transceiver::TX_ECHO_PROBE_INTERVAL - 101;
+    send();
+    assert(!transceiver.tx_echo_pending());
+    send();
+    assert(transceiver.tx_echo_pending());
+    missed_at = now + echo_timeout;
+    assert(transceiver.match_tx_echo(missed_at));
+    send();
+    assert(!transceiver.tx_echo_pending());
+
+    // an echo turns the suppression on again
+    now = missed_at + Transceiver::TX_ECHO_PROBE_INTERVAL - 100;
+    send();
+    assert(transceiver.tx_echo_pending());
+    receive(echo);
+    assert(transceiver.match_tx_echo(now));
+    send();
+    assert(transceiver.tx_echo_pending());
+    receive(echo);
+    assert(transceiver.match_tx_echo(now));
+    assert(transceiver.stats().tx_echoes == 5 && buffer.size() == 0);
 }
 
 int main(int argc, char *argv[])
 {
     test_nasa_1();
     test_nasa_2();
+    test_decode_corrupt_capacity();
     test_process_data();
+    test_crc16();
+    test_messageset_size();
+    test_long_variable();
+    test_decode_structure();
+    test_message_registry();
+    test_shadow_value();
+    test_message_subscriptions();
+    test_nasa_transactions();
+    test_poll_scheduler();
+    test_sequence_tracker();
+    test_merge_request();
+    test_device_address();
+    test_timer_wheel();
+    test_ring_buffer();
+    test_transceiver_resync();
+    test_transceiver_tx();
+    test_transceiver_echo();
 };
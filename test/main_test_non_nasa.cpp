@@ -128,6 +128,7 @@ void test_decoding()
     assert(p.command20.wind_direction == NonNasaWindDirection::Stop);
 
     p = test_decode("3200c8204f4f4efd821c004e8b34");
+    assert(p.src == 0x00 && p.dst == NON_NASA_OUTDOOR);
     assert(p.command20.power == true);
     assert(p.command20.target_temp == 24);
     assert(p.command20.room_temp == 24);
@@ -151,7 +152,7 @@ void test_decoding()
 NonNasaRequest create_request()
 {
     NonNasaRequest p;
-    p.dst = "00";
+    p.dst = 0x00;
     p.power = false;
     p.target_temp = 20;
     p.fanspeed = NonNasaFanspeed::Auto;
@@ -170,7 +171,7 @@ void test_encoding()
     NonNasaRequest req;
 
     req = create_request();
-    req.dst = "00";
+    req.dst = 0x00;
     req.power = true;
     req.room_temp = 23;
     req.target_temp = 24;
@@ -250,7 +251,7 @@ void test_target()
 
 void test_previous_data_is_used_correctly()
 {
-    debug_log_packets = true;
+    debug_log_raw_bytes = true;
 
     // Sending package 20 on non nasa requiers to send the previous values
     // these values need to be stored for each address. This test makes sure
@@ -266,11 +267,11 @@ void test_previous_data_is_used_correctly()
 
     ProtocolRequest req1;
     req1.power = false;
-    get_protocol("00")->publish_request(&target, "00", req1);
-    test_process_data("32c8f0f80345f0c913000000ac34", target); // trigger publish
+    get_protocol(DeviceAddress::parse("00"))->publish_request(&target, DeviceAddress::parse("00"), req1);
+    test_process_data("32c8d0c60100000000000000df34", target); // trigger publish (request_control)
 
     NonNasaRequest request1;
-    request1.dst = "00";
+    request1.dst = 0x00;
     request1.room_temp = 26.000000;
     request1.target_temp = 22.000000;
     request1.power = false;
@@ -285,11 +286,11 @@ void test_previous_data_is_used_correctly()
 
     ProtocolRequest req2;
     req2.power = true;
-    get_protocol("01")->publish_request(&target, "01", req2);
-    test_process_data("32c8f0f80345f0c913000000ac34", target); // trigger publish
+    get_protocol(DeviceAddress::parse("01"))->publish_request(&target, DeviceAddress::parse("01"), req2);
+    test_process_data("32c8d0c60100000000000000df34", target); // trigger publish (request_control)
 
     NonNasaRequest request2;
-    request2.dst = "01";
+    request2.dst = 0x01;
     request2.room_temp = 24.000000;
     request2.target_temp = 24.000000;
     request2.power = true;
@@ -298,6 +299,187 @@ void test_previous_data_is_used_correctly()
     assert_str(bytes_to_hex(request2.encode()), target.last_publish_data);
 }
 
+void test_state_table()
+{
+    NonNasaStateTable table;
+    assert(table.find(0x01) == nullptr);
+
+    NonNasaCommand20 state;
+    state.target_temp = 22;
+    table.update(0x01, state);
+    state.target_temp = 24;
+    table.update(0x02, state);
+    table.update(0x01, state);
+    assert(table.find(0x01)->target_temp == 24);
+    assert(table.find(0x00) == nullptr);
+
+    for (int i = 0x10; i < 0x20; i++)
+        table.update(i, state); // ignored once the table is full
+    assert(table.find(0x1f) == nullptr);
+    assert(table.find(0x02)->target_temp == 24);
+}
+
+void test_request_queue()
+{
+    nonnasa_requests.clear();
+    DebugTarget target;
+    target.now = 1000;
+    test_process_data("3200c8204d51500001100051e434", target); // last values of 00
+
+    // a second request for the same unit is merged into the pending one
+    ProtocolRequest req1;
+    req1.power = true;
+    get_protocol(DeviceAddress::parse("00"))->publish_request(&target, DeviceAddress::parse("00"), req1);
+    ProtocolRequest req2;
+    req2.target_temp = 20;
+    get_protocol(DeviceAddress::parse("00"))->publish_request(&target, DeviceAddress::parse("00"), req2);
+    assert(nonnasa_requests.size() == 1);
+    NonNasaRequestQueueItem *item = nonnasa_requests.find(0x00);
+    assert(item->request.power == true && item->request.target_temp == 20);
+
+    test_process_data("32c8d0c60100000000000000df34", target); // request_control
+    assert(item->sent && item->time_sent == 1000);
+    assert_str(target.last_publish_data, bytes_to_hex(item->request.encode()));
+
+    // a user command preempts the resend of the sent request, the old ack does not remove it
+    ProtocolRequest req3;
+    req3.power = false;
+    get_protocol(DeviceAddress::parse("00"))->publish_request(&target, DeviceAddress::parse("00"), req3);
+    assert(!item->sent && item->resend_count == 0);
+    test_process_data("3200d05400000000000000008434", target); // control_acknowledgement
+    assert(nonnasa_requests.size() == 1);
+
+    test_process_data("32c8d0c60100000000000000df34", target);
+    assert_str(target.last_publish_data, bytes_to_hex(item->request.encode()));
+    test_process_data("3200d05400000000000000008434", target);
+    assert(nonnasa_requests.size() == 0);
+
+    // one slot for each unit, requests for further units are dropped
+    for (int i = 0; i <= NonNasaRequestQueue::CAPACITY; i++)
+        get_protocol(DeviceAddress::non_nasa(i))->publish_request(&target, DeviceAddress::non_nasa(i), req1);
+    assert(nonnasa_requests.size() == NonNasaRequestQueue::CAPACITY);
+    nonnasa_requests.clear();
+}
+
+void test_keepalive()
+{
+    non_nasa_keepalive = true;
+    DebugTarget target;
+    target.now = 1000;
+
+    // the registration is not sent from within the RX path but 30ms later
+    test_process_data("32c8add10100000000000000b534", target);
+    assert(target.last_publish_data.empty());
+    target.now = 1029;
+    target.timers.advance(target.now);
+    assert(target.last_publish_data.empty());
+    target.now = 1030;
+    target.timers.advance(target.now);
+    assert_str(target.last_publish_data, "32d0c8d1d2000000000000001b34");
+    non_nasa_keepalive = false;
+}
+
+void test_timing()
+{
+    NonNasaTiming timing;
+    assert(timing.wake_delay() == NonNasaTiming::DEFAULT_WAKE_DELAY);
+    assert(timing.resend_timeout() == NonNasaTiming::DEFAULT_RESEND_TIMEOUT);
+    assert(timing.expire_timeout() == NonNasaTiming::MAX_EXPIRE_TIMEOUT);
+    assert(!timing.likely_asleep(100000));
+
+    timing.poll_received(1000);
+    timing.poll_received(2000);
+    timing.poll_received(3000);
+    assert(timing.poll_interval() == 1000);
+    assert(timing.wake_delay() == 1500);
+    assert(!timing.likely_asleep(5000));
+    assert(timing.likely_asleep(6500));
+
+    timing.ack_received(200);
+    assert(timing.ack_latency() == 200);
+    assert(timing.resend_timeout() == 1000);
+
+    // the gap while sleeping does not count as poll interval
+    timing.wake_sent(60000);
+    timing.poll_received(60400);
+    assert(timing.poll_interval() == 1000);
+    assert(timing.wake_latency() == 400);
+    assert(timing.expire_timeout() == 1500 + 400 + 4 * 1000);
+
+    // a unit which stopped polling is woken up right away
+    nonnasa_requests.clear();
+    nonnasa_timing = timing;
+    DebugTarget target;
+    target.now = 70000;
+    ProtocolRequest request;
+    request.power = true;
+    get_protocol(DeviceAddress::parse("00"))->publish_request(&target, DeviceAddress::parse("00"), request);
+    target.timers.advance(target.now);
+    assert_str(target.last_publish_data, "32d0c8d1d2000000000000001b34");
+    nonnasa_requests.clear();
+    nonnasa_timing.clear();
+}
+
+size_t count_sent_requests()
+{
+    size_t count = 0;
+    for (auto &item : nonnasa_requests)
+    {
+        if (item.used && item.sent)
+            count++;
+    }
+    return count;
+}
+
+void test_dispatch()
+{
+    nonnasa_requests.clear();
+    nonnasa_timing.clear();
+    nonnasa_timing.poll_received(1000);
+    nonnasa_timing.poll_received(2000);
+    nonnasa_timing.ack_received(400);
+
+    DebugTarget target;
+    target.now = 3000;
+    test_process_data("3200c8204d51500001100051e434", target); // indoor unit is awake
+    ProtocolRequest request;
+    request.power = true;
+    for (uint8_t i = 0; i < 4; i++)
+        get_protocol(DeviceAddress::non_nasa(i))->publish_request(&target, DeviceAddress::non_nasa(i), request);
+
+    // each request takes 400ms until its ack, two of them fit before the next poll
+    test_process_data("32c8d0c60100000000000000df34", target);
+    assert(count_sent_requests() == 1);
+    for (target.now = 3000; target.now < 4000; target.now += 50)
+        target.timers.advance(target.now);
+    assert(count_sent_requests() == 2);
+
+    // the others are sent in the next window, before the unacknowledged ones are resent
+    test_process_data("32c8d0c60100000000000000df34", target);
+    target.now += 400;
+    target.timers.advance(target.now);
+    assert(nonnasa_requests.find(0x02)->sent && nonnasa_requests.find(0x03)->sent);
+    assert(nonnasa_requests.find(0x00)->resend_count == 1 && !nonnasa_requests.find(0x00)->sent);
+
+    // a request queued in an open window with nothing else pending is sent right away
+    nonnasa_requests.clear();
+    target.now = 6000;
+    test_process_data("32c8d0c60100000000000000df34", target);
+    for (; target.now < 6400; target.now += 50)
+        target.timers.advance(target.now);
+    get_protocol(DeviceAddress::non_nasa(0x01))->publish_request(&target, DeviceAddress::non_nasa(0x01), request);
+    assert(nonnasa_requests.find(0x01)->sent && nonnasa_requests.find(0x01)->time_sent == 6400);
+
+    // but not when its ack would arrive after the next poll
+    target.now = 6800;
+    target.timers.advance(target.now);
+    get_protocol(DeviceAddress::non_nasa(0x02))->publish_request(&target, DeviceAddress::non_nasa(0x02), request);
+    assert(!nonnasa_requests.find(0x02)->sent);
+    nonnasa_requests.clear();
+    nonnasa_timing.clear();
+    nonnasa_dispatcher.clear();
+}
+
 int main(int argc, char *argv[])
 {
     // test_read_file();
@@ -306,4 +488,9 @@ int main(int argc, char *argv[])
     test_target();
 
     test_previous_data_is_used_correctly();
+    test_state_table();
+    test_request_queue();
+    test_keepalive();
+    test_timing();
+    test_dispatch();
 };
@@ -3,6 +3,7 @@
 #include <bitset>
 #include <cassert>
 #include <optional>
+#include <set>
 #include "esphome/core/optional.h"
 
 #include "../components/samsung_ac/util.h"
@@ -14,197 +15,304 @@ using namespace esphome::samsung_ac;
 class DebugTarget : public MessageTarget
 {
 public:
+    uint32_t now = 0;
     uint32_t get_miliseconds()
     {
-        return 0;
+        return now;
+    }
+
+    ProtocolTimers timers;
+    ProtocolTimers &get_timers()
+    {
+        return timers;
     }
 
     std::string last_publish_data;
-    void publish_data(std::vector<uint8_t> &data)
+    void publish_data(std::vector<uint8_t> &data, TxPriority)
     {
         last_publish_data = bytes_to_hex(data);
         cout << "> publish_data " << last_publish_data << endl;
     }
 
     std::string last_register_address;
-    void register_address(const std::string address)
+    void register_address(DeviceAddress address)
     {
-        cout << "> register_address " << address << endl;
-        last_register_address = address;
+        cout << "> register_address " << address.to_string() << endl;
+        last_register_address = address.to_string();
     }
 
     std::string last_set_power_address;
     bool last_set_power_value;
-    void set_power(const std::string address, bool value)
+    void set_power(DeviceAddress address, bool value)
     {
-        cout << "> " << address << " set_power=" << to_string(value) << endl;
-        last_set_power_address = address;
+        cout << "> " << address.to_string() << " set_power=" << to_string(value) << endl;
+        last_set_power_address = address.to_string();
         last_set_power_value = value;
     }
 
     std::string last_set_room_temperature_address;
     float last_set_room_temperature_value;
-    void set_room_temperature(const std::string address, float value)
+    void set_room_temperature(DeviceAddress address, float value)
     {
-        cout << "> " << address << " set_room_temperature=" << to_string(value) << endl;
-        last_set_room_temperature_address = address;
+        cout << "> " << address.to_string() << " set_room_temperature=" << to_string(value) << endl;
+        last_set_room_temperature_address = address.to_string();
         last_set_room_temperature_value = value;
     }
 
     std::string last_set_water_temperature_address;
     float last_set_water_temperature_value;
-    void set_water_temperature(const std::string address, float value)
+    void set_water_temperature(DeviceAddress address, float value)
     {
-        cout << "> " << address << " set_water_temperature=" << to_string(value) << endl;
-        last_set_water_temperature_address = address;
+        cout << "> " << address.to_string() << " set_water_temperature=" << to_string(value) << endl;
+        last_set_water_temperature_address = address.to_string();
         last_set_water_temperature_value = value;
     }
 
     std::string last_set_target_temperature_address;
     float last_set_target_temperature_value;
-    void set_target_temperature(const std::string address, float value)
+    void set_target_temperature(DeviceAddress address, float value)
     {
-        cout << "> " << address << " set_target_temperature=" << to_string(value) << endl;
-        last_set_target_temperature_address = address;
+        cout << "> " << address.to_string() << " set_target_temperature=" << to_string(value) << endl;
+        last_set_target_temperature_address = address.to_string();
         last_set_target_temperature_value = value;
     }
 
     std::string last_set_outdoor_temperature_address;
     float last_set_outdoor_temperature_value;
-    void set_outdoor_temperature(const std::string address, float value)
+    void set_outdoor_temperature(DeviceAddress address, float value)
     {
-        cout << "> " << address << " set_outdoor_temperature=" << to_string(value) << endl;
-        last_set_outdoor_temperature_address = address;
+        cout << "> " << address.to_string() << " set_outdoor_temperature=" << to_string(value) << endl;
+        last_set_outdoor_temperature_address = address.to_string();
         last_set_outdoor_temperature_value = value;
+    }
 
-        std::string last_set_target_water_temperature_address;
-        float last_set_target_water_temperature_value;
-        void set_target_water_temperature(const std::string address, float value)
-        {
-            cout << "> " << address << " set_target_water_temperature=" << to_string(value) << endl;
-            last_set_target_water_temperature_address = address;
-            last_set_target_water_temperature_value = value;
-        }
+    std::string last_set_target_water_temperature_address;
+    float last_set_target_water_temperature_value;
+    void set_target_water_temperature(DeviceAddress address, float value)
+    {
+        cout << "> " << address.to_string() << " set_target_water_temperature=" << to_string(value) << endl;
+        last_set_target_water_temperature_address = address.to_string();
+        last_set_target_water_temperature_value = value;
+    }
 
-        std::string last_set_room_humidity_address;
-        float last_set_room_humidity_value;
-        void set_room_humidity(const std::string address, float value)
-        {
-            cout << "> " << address << " set_room_humidity=" << to_string(value) << endl;
-            last_set_room_humidity_address = address;
-            last_set_room_humidity_value = value;
-        }
+    std::string last_set_room_humidity_address;
+    float last_set_room_humidity_value;
+    void set_room_humidity(DeviceAddress address, float value)
+    {
+        cout << "> " << address.to_string() << " set_room_humidity=" << to_string(value) << endl;
+        last_set_room_humidity_address = address.to_string();
+        last_set_room_humidity_value = value;
+    }
 
-        std::string last_set_mode_address;
-        Mode last_set_mode_mode;
-        void set_mode(const std::string address, Mode mode)
-        {
-            cout << "> " << address << " set_mode=" << to_string((int)mode) << endl;
-            last_set_mode_address = address;
-            last_set_mode_mode = mode;
-        }
+    std::string last_set_mode_address;
+    Mode last_set_mode_mode;
+    void set_mode(DeviceAddress address, Mode mode)
+    {
+        cout << "> " << address.to_string() << " set_mode=" << to_string((int)mode) << endl;
+        last_set_mode_address = address.to_string();
+        last_set_mode_mode = mode;
+    }
 
-        std::string last_set_fanmode_address;
-        FanMode last_set_fanmode_mode;
-        void set_fanmode(const std::string address, FanMode fanmode)
-        {
-            cout << "> " << address << " set_fanmode=" << to_string((int)fanmode) << endl;
-            last_set_fanmode_address = address;
-            last_set_fanmode_mode = fanmode;
-        }
+    std::string last_set_fanmode_address;
+    FanMode last_set_fanmode_mode;
+    void set_fanmode(DeviceAddress address, FanMode fanmode)
+    {
+        cout << "> " << address.to_string() << " set_fanmode=" << to_string((int)fanmode) << endl;
+        last_set_fanmode_address = address.to_string();
+        last_set_fanmode_mode = fanmode;
+    }
 
-        void set_altmode(const std::string address, AltMode altmode)
-        {
-            cout << "> " << address << " set_altmode=" << to_string((int)altmode) << endl;
-        }
+    void set_altmode(DeviceAddress address, AltMode altmode)
+    {
+        cout << "> " << address.to_string() << " set_altmode=" << to_string((int)altmode) << endl;
+    }
 
-        void set_swing_vertical(const std::string address, bool vertical)
-        {
-            cout << "> " << address << " set_swing_vertical=" << to_string((int)vertical) << endl;
-        }
+    void set_swing_vertical(DeviceAddress address, bool vertical)
+    {
+        cout << "> " << address.to_string() << " set_swing_vertical=" << to_string((int)vertical) << endl;
+    }
 
-        void set_swing_horizontal(const std::string address, bool horizontal)
-        {
-            cout << "> " << address << " set_swing_horizontal=" << to_string((int)horizontal) << endl;
-        }
+    void set_swing_horizontal(DeviceAddress address, bool horizontal)
+    {
+        cout << "> " << address.to_string() << " set_swing_horizontal=" << to_string((int)horizontal) << endl;
+    }
 
-        void set_custom_sensor(const std::string address, uint16_t message_number, float value)
-        {
-            last_custom_sensors.insert(message_number);
-        }
+    void set_automatic_cleaning(DeviceAddress address, bool value)
+    {
+        cout << "> " << address.to_string() << " set_automatic_cleaning=" << to_string(value) << endl;
+    }
+
+    void set_water_heater_power(DeviceAddress address, bool value)
+    {
+        cout << "> " << address.to_string() << " set_water_heater_power=" << to_string(value) << endl;
+    }
+
+    void set_water_outlet_target(DeviceAddress address, float value)
+    {
+        cout << "> " << address.to_string() << " set_water_outlet_target=" << to_string(value) << endl;
+    }
+
+    void set_indoor_eva_in_temperature(DeviceAddress address, float value)
+    {
+        cout << "> " << address.to_string() << " set_indoor_eva_in_temperature=" << to_string(value) << endl;
+    }
+
+    void set_indoor_eva_out_temperature(DeviceAddress address, float value)
+    {
+        cout << "> " << address.to_string() << " set_indoor_eva_out_temperature=" << to_string(value) << endl;
+    }
+
+    void set_water_heater_mode(DeviceAddress address, WaterHeaterMode waterheatermode)
+    {
+        cout << "> " << address.to_string() << " set_water_heater_mode=" << to_string((int)waterheatermode) << endl;
+    }
+
+    void set_error_code(DeviceAddress address, int error_code)
+    {
+        cout << "> " << address.to_string() << " set_error_code=" << to_string(error_code) << endl;
+    }
 
-        void assert_only_address(const std::string address)
+    int set_state_calls = 0;
+    void set_state(DeviceAddress address, const DeviceState &state)
+    {
+        set_state_calls++;
+        if (state.power)
+            set_power(address, state.power.value());
+        if (state.automatic_cleaning)
+            set_automatic_cleaning(address, state.automatic_cleaning.value());
+        if (state.water_heater_power)
+            set_water_heater_power(address, state.water_heater_power.value());
+        if (state.room_temperature)
+            set_room_temperature(address, state.room_temperature.value());
+        if (state.target_temperature)
+            set_target_temperature(address, state.target_temperature.value());
+        if (state.water_outlet_target)
+            set_water_outlet_target(address, state.water_outlet_target.value());
+        if (state.outdoor_temperature)
+            set_outdoor_temperature(address, state.outdoor_temperature.value());
+        if (state.indoor_eva_in_temperature)
+            set_indoor_eva_in_temperature(address, state.indoor_eva_in_temperature.value());
+        if (state.indoor_eva_out_temperature)
+            set_indoor_eva_out_temperature(address, state.indoor_eva_out_temperature.value());
+        if (state.target_water_temperature)
+            set_target_water_temperature(address, state.target_water_temperature.value());
+        if (state.mode)
+            set_mode(address, state.mode.value());
+        if (state.water_heater_mode)
+            set_water_heater_mode(address, state.water_heater_mode.value());
+        if (state.fanmode)
+            set_fanmode(address, state.fanmode.value());
+        if (state.altmode)
+            set_altmode(address, state.altmode.value());
+        if (state.swing_vertical)
+            set_swing_vertical(address, state.swing_vertical.value());
+        if (state.swing_horizontal)
+            set_swing_horizontal(address, state.swing_horizontal.value());
+        if (state.error_code)
+            set_error_code(address, state.error_code.value());
+        for (const auto &value : state.custom_sensors)
         {
-            assert(last_register_address == address);
-            assert(last_set_power_address == "");
-            assert(last_set_room_temperature_address == "");
-            assert(last_set_target_temperature_address == "");
-            assert(last_set_mode_address == "");
-            assert(last_set_fanmode_address == "");
+            set_custom_sensor(address, value.message_number, value.value);
+            last_custom_sensor = value;
         }
+    }
 
-        void assert_values(const std::string address, bool power, float room_temp, float target_temp, Mode mode, FanMode fanmode)
-        {
-            assert(last_register_address == address);
+    std::set<uint16_t> last_custom_sensors;
+    CustomSensorValue last_custom_sensor{};
+    void set_custom_sensor(DeviceAddress address, uint16_t message_number, float value)
+    {
+        last_custom_sensors.insert(message_number);
+    }
 
-            assert(last_set_power_address == address);
-            assert(last_set_power_value == power);
+    void assert_only_address(const std::string address)
+    {
+        assert(last_register_address == address);
+        assert(last_set_power_address == "");
+        assert(last_set_room_temperature_address == "");
+        assert(last_set_target_temperature_address == "");
+        assert(last_set_mode_address == "");
+        assert(last_set_fanmode_address == "");
+    }
 
-            assert(last_set_room_temperature_address == address);
-            assert(last_set_room_temperature_value == room_temp);
+    void assert_values(const std::string address, bool power, float room_temp, float target_temp, Mode mode, FanMode fanmode)
+    {
+        assert(last_register_address == address);
 
-            assert(last_set_target_temperature_address == address);
-            assert(last_set_target_temperature_value == target_temp);
+        assert(last_set_power_address == address);
+        assert(last_set_power_value == power);
 
-            assert(last_set_mode_address == address);
-            assert(last_set_mode_mode == mode);
+        assert(last_set_room_temperature_address == address);
+        assert(last_set_room_temperature_value == room_temp);
 
-            assert(last_set_fanmode_address == address);
-            assert(last_set_fanmode_mode == fanmode);
-        }
+        assert(last_set_target_temperature_address == address);
+        assert(last_set_target_temperature_value == target_temp);
 
-        void assert_values(const std::string address, bool power, float room_temp, float target_temp, Mode mode, FanMode fanmode, float humidity)
-        {
-            assert_values(address, power, room_temp, target_temp, mode, fanmode);
+        assert(last_set_mode_address == address);
+        assert(last_set_mode_mode == mode);
 
-            assert(last_set_room_humidity_address == address);
-            assert(last_set_room_humidity_value == humidity);
-        }
-    };
+        assert(last_set_fanmode_address == address);
+        assert(last_set_fanmode_mode == fanmode);
+    }
 
-    void test_process_data(const std::string &hex, DebugTarget &target)
+    void assert_values(const std::string address, bool power, float room_temp, float target_temp, Mode mode, FanMode fanmode, float humidity)
     {
-        cout << "test: " << hex << std::endl;
-        auto bytes = hex_to_bytes(hex);
-        assert(process_data(bytes, &target) == DataResult::Clear);
+        assert_values(address, power, room_temp, target_temp, mode, fanmode);
+
+        assert(last_set_room_humidity_address == address);
+        assert(last_set_room_humidity_value == humidity);
     }
+};
 
-    DebugTarget test_process_data(const std::string &hex)
+// Feeds the bytes through a FrameParser like Samsung_AC does, every complete frame is processed.
+void test_process_data(const std::string &hex, DebugTarget &target)
+{
+    cout << "test: " << hex << std::endl;
+    auto bytes = hex_to_bytes(hex);
+    FrameParser parser;
+    size_t start = 0;
+    for (size_t i = 0; i < bytes.size(); i++)
     {
-        DebugTarget target;
-        test_process_data(hex, target);
-        return target;
+        FrameResult frame = parser.feed(bytes[i]);
+        if (frame == FrameResult::Incomplete)
+            continue;
+
+        assert(frame != FrameResult::Invalid);
+        process_frame(frame, ByteSpan(bytes.data() + start, i + 1 - start), &target);
+        start = i + 1;
     }
+    assert(start == bytes.size());
+}
+
+DebugTarget test_process_data(const std::string &hex)
+{
+    DebugTarget target;
+    test_process_data(hex, target);
+    return target;
+}
 
-    void assert_str(const std::string actual, const std::string expected)
+void assert_str(const std::string actual, const std::string expected)
+{
+    if (actual != expected)
     {
-        if (actual != expected)
-        {
-            cout << "actual:   " << actual << std::endl;
-            cout << "expected: " << expected << std::endl;
-        }
-        assert(actual == expected);
+        cout << "actual:   " << actual << std::endl;
+        cout << "expected: " << expected << std::endl;
     }
+    assert(actual == expected);
+}
 
-    namespace esphome
+namespace esphome
+{
+    uint32_t millis()
     {
-        uint32_t millis()
-        {
-            return 0;
-        }
-        uint32_t micros()
-        {
-            return 0;
-        }
-        void delay(uint32_t ms) {}
-    } // namespace esphome
+        return 0;
+    }
+    uint32_t micros()
+    {
+        return 0;
+    }
+    void delay(uint32_t ms) {}
+    uint32_t random_uint32()
+    {
+        return 0;
+    }
+} // namespace esphome